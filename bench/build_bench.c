@@ -0,0 +1,75 @@
+// Builds and runs the sdl_common.c work queue benchmarks against sdl_stub.c instead of SDL,
+// so they only need a c compiler and pthreads (linux, macos, mingw with winpthreads).
+// cc build_bench.c -o build_bench && ./build_bench [norun]
+#define VL_BUILD_IMPLEMENTATION
+#include "../vl_build.h"
+
+typedef struct {
+    const char *name; // bench/<name>.c, built to bin/<name>
+    bool stealing; // also built with WORK_QUEUE_WORK_STEALING to bin/<name>_stealing
+} bench;
+
+static bench benches[] = {
+    {"work_queue_throughput", false},
+    {"work_queue_fork_join", true},
+    {"work_queue_burst", true},
+    {"work_queue_group", true},
+    {"work_queue_parallel_for", true},
+};
+
+static bool BuildBench(vl_cmd *cmd, const char *source, const char *output, bool stealing)
+{
+    vl_compile_ctx ctx = {
+        .optimize = Optimize_Speed,
+        .warnings = true,
+        .sourceFiles = VL_GetDaStrSlice(source, "../sdl_stub.c"),
+        .outputPath = output,
+        .includePaths = VL_GetDaStrSlice("include", "../../template_files", "../../template_files/SDL3"),
+        .libs = VL_GetDaStrSlice("pthread"),
+    };
+    vl_file_paths stealingFlags = VL_GetDaStrSlice("-DWORK_QUEUE_WORK_STEALING");
+    if(stealing) ctx.extraCompilerFlags = stealingFlags;
+
+    VL_SetupCCompile(cmd, &ctx);
+    return CmdRun(cmd);
+}
+
+int main(int argc, char **argv)
+{
+    VL_GO_REBUILD_URSELF(argc, argv);
+
+    bool shouldrun = true;
+    while(argc > 1) {
+        char *arg = argv[--argc];
+        if(!strcmp(arg, "norun")) {
+            shouldrun = false;
+        }
+    }
+
+    vl_cmd cmd = {0};
+    MkdirIfNotExist("bin");
+    MkdirIfNotExist("bin/include");
+    if(!VL_CopyDirectoryRecursively("../template_files/SDL3/include", "bin/include/SDL3", .sync = true)) return 1;
+
+    VL_Pushd("bin");
+    for(size_t i = 0; i < ArrayLen(benches); i++) {
+        const char *source = temp_sprintf("../%s.c", benches[i].name);
+        if(!BuildBench(&cmd, source, benches[i].name, false)) return 1;
+        if(benches[i].stealing &&
+           !BuildBench(&cmd, source, temp_sprintf("%s_stealing", benches[i].name), true)) return 1;
+    }
+
+    if(shouldrun) {
+        for(size_t i = 0; i < ArrayLen(benches); i++) {
+            CmdAppend(&cmd, temp_sprintf("./%s", benches[i].name));
+            if(!CmdRun(&cmd)) return 1;
+            if(benches[i].stealing) {
+                CmdAppend(&cmd, temp_sprintf("./%s_stealing", benches[i].name));
+                if(!CmdRun(&cmd)) return 1;
+            }
+        }
+    }
+    VL_Popd();
+
+    return 0;
+}
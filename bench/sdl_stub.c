@@ -0,0 +1,116 @@
+// NOTE: Stand-ins for the few SDL functions the sdl_common.c work queue uses, so the benchmarks
+// build and run without SDL installed. Atomics are C11, threads and semaphores are pthreads.
+#include <SDL3/SDL.h>
+#include <pthread.h>
+#include <semaphore.h>
+#include <stdatomic.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdarg.h>
+#include <time.h>
+#include <sched.h>
+#include <unistd.h>
+
+int SDL_AddAtomicInt(SDL_AtomicInt *a, int v) { return atomic_fetch_add((_Atomic int *)&a->value, v); }
+int SDL_GetAtomicInt(SDL_AtomicInt *a) { return atomic_load((_Atomic int *)&a->value); }
+int SDL_SetAtomicInt(SDL_AtomicInt *a, int v) { return atomic_exchange((_Atomic int *)&a->value, v); }
+bool SDL_CompareAndSwapAtomicInt(SDL_AtomicInt *a, int oldval, int newval)
+{
+    return atomic_compare_exchange_strong((_Atomic int *)&a->value, &oldval, newval);
+}
+
+Uint32 SDL_GetAtomicU32(SDL_AtomicU32 *a) { return atomic_load((_Atomic Uint32 *)&a->value); }
+Uint32 SDL_SetAtomicU32(SDL_AtomicU32 *a, Uint32 v) { return atomic_exchange((_Atomic Uint32 *)&a->value, v); }
+bool SDL_CompareAndSwapAtomicU32(SDL_AtomicU32 *a, Uint32 oldval, Uint32 newval)
+{
+    return atomic_compare_exchange_strong((_Atomic Uint32 *)&a->value, &oldval, newval);
+}
+
+void SDL_LockSpinlock(SDL_SpinLock *lock) { while(__atomic_exchange_n(lock, 1, __ATOMIC_ACQUIRE)) sched_yield(); }
+void SDL_UnlockSpinlock(SDL_SpinLock *lock) { __atomic_store_n(lock, 0, __ATOMIC_RELEASE); }
+
+SDL_Semaphore *SDL_CreateSemaphore(Uint32 initial_value)
+{
+    sem_t *sem = malloc(sizeof(sem_t));
+    sem_init(sem, 0, initial_value);
+    return (SDL_Semaphore *)sem;
+}
+// NOTE: Counted so the benchmarks can check nothing wakes up the workers more than it should
+SDL_AtomicInt stubSemaphoreSignals;
+void SDL_SignalSemaphore(SDL_Semaphore *sem)
+{
+    SDL_AddAtomicInt(&stubSemaphoreSignals, 1);
+    sem_post((sem_t *)sem);
+}
+void SDL_WaitSemaphore(SDL_Semaphore *sem) { sem_wait((sem_t *)sem); }
+
+typedef struct {
+    SDL_ThreadFunction fn;
+    void *data;
+} stub_thread;
+
+static void *StubThreadProc(void *param)
+{
+    stub_thread thread = *(stub_thread *)param;
+    thread.fn(thread.data);
+    return NULL;
+}
+
+SDL_Thread *SDL_CreateThreadRuntime(SDL_ThreadFunction fn, const char *name, void *data,
+                                    SDL_FunctionPointer pfnBeginThread, SDL_FunctionPointer pfnEndThread)
+{
+    (void)name; (void)pfnBeginThread; (void)pfnEndThread;
+    // NOTE: Workers never exit, so the struct is kept around as the SDL_Thread handle
+    stub_thread *thread = malloc(sizeof(*thread));
+    thread->fn = fn;
+    thread->data = data;
+    pthread_t handle;
+    if(pthread_create(&handle, NULL, StubThreadProc, thread) != 0) {
+        free(thread);
+        return NULL;
+    }
+    pthread_detach(handle);
+    return (SDL_Thread *)thread;
+}
+
+// NOTE: sdl_common.c only uses one TLS slot
+static __thread const void *stubTLS;
+void *SDL_GetTLS(SDL_TLSID *id) { (void)id; return (void *)stubTLS; }
+bool SDL_SetTLS(SDL_TLSID *id, const void *value, SDL_TLSDestructorCallback destructor)
+{
+    (void)id; (void)destructor;
+    stubTLS = value;
+    return true;
+}
+
+void SDL_Delay(Uint32 ms)
+{
+    if(ms) usleep(ms*1000);
+    else sched_yield();
+}
+
+Uint64 SDL_GetTicksNS(void)
+{
+    struct timespec t;
+    clock_gettime(CLOCK_MONOTONIC, &t);
+    return (Uint64)t.tv_sec*1000000000ull + (Uint64)t.tv_nsec;
+}
+
+void *SDL_malloc(size_t size) { return malloc(size); }
+void SDL_free(void *mem) { free(mem); }
+size_t SDL_strlen(const char *str) { return strlen(str); }
+int SDL_snprintf(char *text, size_t maxlen, const char *fmt, ...)
+{
+    va_list ap;
+    va_start(ap, fmt);
+    int result = vsnprintf(text, maxlen, fmt, ap);
+    va_end(ap);
+    return result;
+}
+
+SDL_AssertState SDL_ReportAssertion(SDL_AssertData *data, const char *func, const char *file, int line)
+{
+    fprintf(stderr, "%s:%d: %s: Assertion '%s' failed\n", file, line, func, data->condition);
+    abort();
+}
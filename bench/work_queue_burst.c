@@ -0,0 +1,63 @@
+// Bursts of work bigger than the WORK_QUEUE_SIZE ring, so AddWorkEntry has to wait for room:
+// the main thread adds ROOTS jobs at once and every root adds FANOUT more from its worker,
+// which also fills up the ring (and the worker's deque with WORK_QUEUE_WORK_STEALING).
+// usage: work_queue_burst [workers] [roots] [reps]
+#include "sdl_common.c"
+#include <stdio.h>
+#include <stdlib.h>
+
+#define FANOUT 64
+
+static WorkQueue queue;
+static SpallProfile spall;
+static SDL_AtomicInt rootsDone;
+static SDL_AtomicInt leavesDone;
+
+static int Leaf(SpallProfile *spall_ctx, SpallBuffer *spall_buffer, void *data)
+{
+    (void)spall_ctx; (void)spall_buffer; (void)data;
+    SDL_AddAtomicInt(&leavesDone, 1);
+    return 0;
+}
+
+static int Root(SpallProfile *spall_ctx, SpallBuffer *spall_buffer, void *data)
+{
+    (void)spall_ctx; (void)spall_buffer; (void)data;
+    for(int i = 0; i < FANOUT; i++) AddWorkEntry(&queue, Leaf, NULL);
+    SDL_AddAtomicInt(&rootsDone, 1);
+    return 0;
+}
+
+int main(int argc, char **argv)
+{
+    int workers = argc > 1 ? atoi(argv[1]) : 2;
+    int roots = argc > 2 ? atoi(argv[2]) : 2000;
+    int reps = argc > 3 ? atoi(argv[3]) : 20;
+
+    spall_init_file("work_queue_burst.spall", 1, &spall);
+    if(!InitWorkQueue(&spall, &queue, workers)) return 1;
+
+    Uint64 start = SDL_GetTicksNS();
+    for(int rep = 0; rep < reps; rep++) {
+        SDL_SetAtomicInt(&rootsDone, 0);
+        SDL_SetAtomicInt(&leavesDone, 0);
+        for(int i = 0; i < roots; i++) AddWorkEntry(&queue, Root, NULL);
+        CompleteAllWorkerEntries(&spall, NULL, &queue);
+        if(SDL_GetAtomicInt(&rootsDone) != roots || SDL_GetAtomicInt(&leavesDone) != roots*FANOUT) {
+            printf("FAIL rep %d: %d roots and %d leaves done, expected %d and %d\n", rep,
+                   SDL_GetAtomicInt(&rootsDone), SDL_GetAtomicInt(&leavesDone), roots, roots*FANOUT);
+            return 1;
+        }
+    }
+    Uint64 ns = SDL_GetTicksNS() - start;
+
+#ifdef WORK_QUEUE_WORK_STEALING
+    const char *scheduler = "stealing";
+#else
+    const char *scheduler = "ring";
+#endif
+    int total = reps*roots*(FANOUT + 1);
+    printf("%s, %d workers, bursts of %d roots (queue size %d): %d jobs in %.1f ms, %.2f M jobs/s\n",
+           scheduler, workers, roots, WORK_QUEUE_SIZE, total, ns/1e6, total/(ns/1e3));
+    return 0;
+}
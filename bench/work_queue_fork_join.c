@@ -0,0 +1,58 @@
+// Fork/join load on the sdl_common.c work queue: the main thread adds a few root jobs and each one
+// adds FANOUT tiny leaf jobs from its worker. Built with and without WORK_QUEUE_WORK_STEALING to
+// compare the shared ring with the per-worker deques.
+// usage: work_queue_fork_join [workers] [roots] [reps]
+#include "sdl_common.c"
+#include <stdio.h>
+#include <stdlib.h>
+
+#define FANOUT 64
+
+static WorkQueue queue;
+static SpallProfile spall;
+static SDL_AtomicInt leavesDone;
+
+static int Leaf(SpallProfile *spall_ctx, SpallBuffer *spall_buffer, void *data)
+{
+    (void)spall_ctx; (void)spall_buffer; (void)data;
+    SDL_AddAtomicInt(&leavesDone, 1);
+    return 0;
+}
+
+static int Root(SpallProfile *spall_ctx, SpallBuffer *spall_buffer, void *data)
+{
+    (void)spall_ctx; (void)spall_buffer; (void)data;
+    for(int i = 0; i < FANOUT; i++) AddWorkEntry(&queue, Leaf, NULL);
+    return 0;
+}
+
+int main(int argc, char **argv)
+{
+    int workers = argc > 1 ? atoi(argv[1]) : 2;
+    int roots = argc > 2 ? atoi(argv[2]) : 3;
+    int reps = argc > 3 ? atoi(argv[3]) : 3000;
+
+    spall_init_file("work_queue_fork_join.spall", 1, &spall);
+    if(!InitWorkQueue(&spall, &queue, workers)) return 1;
+
+    Uint64 start = SDL_GetTicksNS();
+    for(int rep = 0; rep < reps; rep++) {
+        for(int i = 0; i < roots; i++) AddWorkEntry(&queue, Root, NULL);
+        CompleteAllWorkerEntries(&spall, NULL, &queue);
+    }
+    Uint64 ns = SDL_GetTicksNS() - start;
+
+    if(SDL_GetAtomicInt(&leavesDone) != reps*roots*FANOUT) {
+        printf("FAIL: %d leaves done, expected %d\n", SDL_GetAtomicInt(&leavesDone), reps*roots*FANOUT);
+        return 1;
+    }
+    int total = reps*roots*(FANOUT + 1);
+#ifdef WORK_QUEUE_WORK_STEALING
+    const char *scheduler = "stealing";
+#else
+    const char *scheduler = "ring";
+#endif
+    printf("%s, %d workers, %d roots: %d jobs in %.1f ms, %.2f M jobs/s\n",
+           scheduler, workers, roots, total, ns/1e6, total/(ns/1e3));
+    return 0;
+}
@@ -0,0 +1,99 @@
+// ParallelFor on the sdl_common.c work queue: every element is visited exactly once for a range of
+// sizes and minChunks (also when nested inside another ParallelFor running on the workers), then
+// the time of a 4M element loop against running it serially, and the overhead per call for small loops.
+// usage: work_queue_parallel_for [workers]
+#include "sdl_common.c"
+#include <stdio.h>
+#include <stdlib.h>
+
+#define NESTED_OUTER 64
+#define NESTED_INNER 1000
+
+static WorkQueue queue;
+static SpallProfile spall;
+static SDL_AtomicInt chunks;
+static float *xs;
+
+// NOTE: data is the array of visit counts for the range
+static void Mark(SpallProfile *spall_ctx, SpallBuffer *spall_buffer, void *data, Uint32 start, Uint32 end)
+{
+    (void)spall_ctx; (void)spall_buffer;
+    Uint8 *visits = data;
+    SDL_AddAtomicInt(&chunks, 1);
+    for(Uint32 i = start; i < end; i++) visits[i]++;
+}
+
+// NOTE: Every outer element marks its own row with an inner ParallelFor
+static void MarkNested(SpallProfile *spall_ctx, SpallBuffer *spall_buffer, void *data, Uint32 start, Uint32 end)
+{
+    Uint8 *rows = data;
+    for(Uint32 i = start; i < end; i++) {
+        ParallelFor(spall_ctx, spall_buffer, &queue, NESTED_INNER, 16, Mark, rows + i*NESTED_INNER);
+    }
+}
+
+static void Transform(SpallProfile *spall_ctx, SpallBuffer *spall_buffer, void *data, Uint32 start, Uint32 end)
+{
+    (void)spall_ctx; (void)spall_buffer; (void)data;
+    for(Uint32 i = start; i < end; i++) xs[i] = xs[i]*0.5f + 1.0f;
+}
+
+static bool CheckVisits(const Uint8 *visits, Uint32 count, const char *what, Uint32 minChunk)
+{
+    for(Uint32 i = 0; i < count; i++) {
+        if(visits[i] != 1) {
+            printf("FAIL %s count %u minChunk %u: element %u visited %d times\n", what, count, minChunk, i, visits[i]);
+            return false;
+        }
+    }
+    return true;
+}
+
+int main(int argc, char **argv)
+{
+    int workers = argc > 1 ? atoi(argv[1]) : 2;
+
+    spall_init_file("work_queue_parallel_for.spall", 1, &spall);
+    if(!InitWorkQueue(&spall, &queue, workers)) return 1;
+    SpallBuffer mainBuffer = {.data = malloc(SPALL_BUFFER_SIZE), .length = SPALL_BUFFER_SIZE};
+    spall_buffer_init(&spall, &mainBuffer);
+
+    Uint32 counts[] = {0, 1, 7, 64, 1000, 100003, 5000000};
+    Uint32 minChunks[] = {0, 1, 16, 4096};
+    Uint8 *visits = malloc(5000000);
+    for(size_t countIdx = 0; countIdx < SDL_arraysize(counts); countIdx++) {
+        for(size_t minIdx = 0; minIdx < SDL_arraysize(minChunks); minIdx++) {
+            Uint32 count = counts[countIdx];
+            memset(visits, 0, count);
+            SDL_SetAtomicInt(&chunks, 0);
+            ParallelFor(&spall, &mainBuffer, &queue, count, minChunks[minIdx], Mark, visits);
+            if(!CheckVisits(visits, count, "flat", minChunks[minIdx])) return 1;
+            if(countIdx == SDL_arraysize(counts) - 1) {
+                printf("count %u minChunk %u: %d chunks\n", count, minChunks[minIdx], SDL_GetAtomicInt(&chunks));
+            }
+        }
+    }
+
+    memset(visits, 0, NESTED_OUTER*NESTED_INNER);
+    ParallelFor(&spall, &mainBuffer, &queue, NESTED_OUTER, 1, MarkNested, visits);
+    if(!CheckVisits(visits, NESTED_OUTER*NESTED_INNER, "nested", 1)) return 1;
+
+    Uint32 n = 1 << 22;
+    xs = malloc(n*sizeof(float));
+    for(Uint32 i = 0; i < n; i++) xs[i] = (float)i;
+    Uint64 t0 = SDL_GetTicksNS();
+    for(int rep = 0; rep < 20; rep++) Transform(NULL, NULL, NULL, 0, n);
+    Uint64 t1 = SDL_GetTicksNS();
+    for(int rep = 0; rep < 20; rep++) ParallelFor(&spall, &mainBuffer, &queue, n, 4096, Transform, NULL);
+    Uint64 t2 = SDL_GetTicksNS();
+    // NOTE: One chunk never touches the queue, 64 per chunk splits 1000 elements among every worker
+    for(int rep = 0; rep < 10000; rep++) ParallelFor(&spall, &mainBuffer, &queue, 1000, 4096, Transform, NULL);
+    Uint64 t3 = SDL_GetTicksNS();
+    for(int rep = 0; rep < 10000; rep++) ParallelFor(&spall, &mainBuffer, &queue, 1000, 64, Transform, NULL);
+    Uint64 t4 = SDL_GetTicksNS();
+
+    printf("%d workers: 4M floats serial %.2f ms, ParallelFor %.2f ms\n", workers, (t1 - t0)/20e6, (t2 - t1)/20e6);
+    printf("%d workers: 1000 elements in one chunk %.2f us/call, split up %.2f us/call\n",
+           workers, (t3 - t2)/10000e3, (t4 - t3)/10000e3);
+    return 0;
+}
@@ -0,0 +1,91 @@
+// Enqueue/dequeue throughput of the sdl_common.c work queue with 1..N producer threads.
+// usage: work_queue_throughput [workers] [max producers] [subjobs]
+// With a third argument every job also adds a sub-job from its worker.
+#include "sdl_common.c"
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <sched.h>
+
+#ifndef JOBS_PER_PRODUCER
+#define JOBS_PER_PRODUCER 200000
+#endif
+
+#define MAX_PRODUCERS 64
+
+static WorkQueue queue;
+static SpallProfile spall;
+static SDL_AtomicInt jobsDone;
+static SDL_AtomicInt subJobsDone;
+static unsigned char *jobRan;
+static bool addSubJobs;
+
+static int SubJob(SpallProfile *spall_ctx, SpallBuffer *spall_buffer, void *data)
+{
+    (void)spall_ctx; (void)spall_buffer; (void)data;
+    SDL_AddAtomicInt(&subJobsDone, 1);
+    return 0;
+}
+
+static int Job(SpallProfile *spall_ctx, SpallBuffer *spall_buffer, void *data)
+{
+    (void)spall_ctx; (void)spall_buffer;
+    intptr_t id = (intptr_t)data;
+    if(jobRan[id]++) {
+        fprintf(stderr, "job %ld ran twice\n", (long)id);
+        abort();
+    }
+    if(addSubJobs) {
+        while(!TryAddWorkEntry(&queue, SubJob, NULL)) sched_yield();
+    }
+    SDL_AddAtomicInt(&jobsDone, 1);
+    return 0;
+}
+
+static void *Producer(void *param)
+{
+    intptr_t base = (intptr_t)param*JOBS_PER_PRODUCER;
+    for(intptr_t i = 0; i < JOBS_PER_PRODUCER; i++) {
+        while(!TryAddWorkEntry(&queue, Job, (void *)(base + i))) sched_yield();
+    }
+    return NULL;
+}
+
+int main(int argc, char **argv)
+{
+    int workers = argc > 1 ? atoi(argv[1]) : 2;
+    int maxProducers = argc > 2 ? atoi(argv[2]) : 4;
+    addSubJobs = argc > 3;
+    if(maxProducers < 1 || maxProducers > MAX_PRODUCERS) {
+        fprintf(stderr, "max producers must be between 1 and %d\n", MAX_PRODUCERS);
+        return 1;
+    }
+
+    spall_init_file("work_queue_throughput.spall", 1, &spall);
+    if(!InitWorkQueue(&spall, &queue, workers)) return 1;
+
+    size_t maxJobs = (size_t)maxProducers*JOBS_PER_PRODUCER;
+    jobRan = malloc(maxJobs);
+    for(int producers = 1; producers <= maxProducers; producers++) {
+        memset(jobRan, 0, maxJobs);
+        SDL_SetAtomicInt(&jobsDone, 0);
+        SDL_SetAtomicInt(&subJobsDone, 0);
+
+        pthread_t threads[MAX_PRODUCERS];
+        Uint64 start = SDL_GetTicksNS();
+        for(int i = 0; i < producers; i++) pthread_create(&threads[i], NULL, Producer, (void *)(intptr_t)i);
+        for(int i = 0; i < producers; i++) pthread_join(threads[i], NULL);
+        CompleteAllWorkerEntries(&spall, NULL, &queue);
+        Uint64 ns = SDL_GetTicksNS() - start;
+
+        int total = producers*JOBS_PER_PRODUCER;
+        if(SDL_GetAtomicInt(&jobsDone) != total || (addSubJobs && SDL_GetAtomicInt(&subJobsDone) != total)) {
+            printf("FAIL: %d jobs and %d sub-jobs done, expected %d\n",
+                   SDL_GetAtomicInt(&jobsDone), SDL_GetAtomicInt(&subJobsDone), total);
+            return 1;
+        }
+        printf("%d producer(s), %d workers%s: %d jobs in %.1f ms, %.2f M jobs/s\n",
+               producers, workers, addSubJobs ? " + sub-jobs" : "", total, ns/1e6, total/(ns/1e3));
+    }
+    return 0;
+}
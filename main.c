@@ -25,15 +25,32 @@ WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE. */
 # define SHORTCUT_PATH_ARG
 #endif
 
-#define VL_REBUILD_URSELF(bin, src) VL_DEFAULT_REBUILD_URSELF(bin, src), SHORTCUT_PATH_ARG
+#if defined(TEMPLATE_EMBED)
+# define TEMPLATE_EMBED_ARG , "-DTEMPLATE_EMBED"
+#else
+# define TEMPLATE_EMBED_ARG
+#endif
+
+#define VL_REBUILD_URSELF(bin, src) VL_DEFAULT_REBUILD_URSELF(bin, src) SHORTCUT_PATH_ARG TEMPLATE_EMBED_ARG
 #define VL_BUILD_IMPLEMENTATION
 #include "vl_build.h"
 
+// Built with -DTEMPLATE_EMBED, every template is compiled into the executable. templates_embed.h is
+// generated when running it in its own directory, right before it rebuilds itself with it
+#define TEMPLATE_EMBED_FILE "templates_embed.h"
+#if defined(TEMPLATE_EMBED) && defined(__has_include)
+# if __has_include("templates_embed.h")
+#  include "templates_embed.h"
+# endif
+#endif
+
 #if defined(_WIN32)
 #include <consoleapi.h>
 #endif
 
 char *selfPath;
+// How the assets that don't get modified (SDL, spall.h, viclib.h, vl_build.h) end up in the project
+vl_link_mode linkMode = VL_LINK_NONE;
 
 void Usage(char *program)
 {
@@ -43,6 +60,18 @@ void Usage(char *program)
            " - SDL3-hotreload\n"
            " - SDL3-gpu\n"
            "\n"
+           "\n"
+           "Options:\n"
+           " - hardlink: hard link the SDL files, spall.h, viclib.h and vl_build.h instead of copying them\n"
+           " - symlink: same as hardlink but with symbolic links to this program's directory\n"
+           "   Linked files are shared with the template, don't modify them.\n"
+           "   They get copied when linking is not possible (e.g. a different drive)\n"
+           "\n"
+           "Other commands:\n"
+           " - pack: pack every template into templates.pack next to this program, templates get made\n"
+           "   from it instead of template_files so this program and the pack are all that's needed\n"
+           " - info <template>: show the README of a template\n"
+           "\n"
            "This program will make a template program in the current directory\n",
            program);
 }
@@ -67,31 +96,650 @@ const char *TemplateToString(Template t)
 
 Template chosenTemplate = Template_None;
 
+// templates.pack, next to the executable, holds every file the templates need so making a
+// project opens one file instead of hundreds. Made with the 'pack' command.
+// Layout: pack_header | pack_entry[count] sorted by name | names | file data
+#define PACK_FILE_NAME "templates.pack"
+#define PACK_MAGIC "VLTPACK1"
+
+typedef struct {
+    char magic[8];
+    u32 count;
+    u32 namesSize;
+} pack_header;
+
+typedef struct {
+    u64 offset; /* from the start of the pack */
+    u64 size;
+    u64 packedSize; /* same as size if it's not compressed */
+    u32 nameOffset; /* into the names, relative to selfPath like "template_files/spall.h" */
+    u32 nameLen;
+} pack_entry;
+
+typedef struct {
+    vl_mapped_file map;
+    pack_entry *entries;
+    u32 count;
+    const char *names;
+    /* perfect hash, only for the embedded pack */
+    const u32 *seeds;
+    u32 bucketCount;
+    const u16 *slots;
+    u32 slotCount;
+} template_pack;
+
+// Only used if it was opened
+template_pack pack;
+
+#define PACK_MIN_MATCH 4
+#define PACK_HASH_BITS 14
+
+u32 PackHash(const u8 *p)
+{
+    u32 v;
+    memcpy(&v, p, sizeof(v));
+    return (v*2654435761u) >> (32 - PACK_HASH_BITS);
+}
+
+u8 *PackPutLength(u8 *out, u8 *end, size_t len)
+{
+    for(; len >= 255; len -= 255) {
+        if(out >= end) return 0;
+        *out++ = 255;
+    }
+    if(out >= end) return 0;
+    *out++ = (u8)len;
+    return out;
+}
+
+u8 *PackPutSequence(u8 *out, u8 *end, const u8 *literals, size_t literalCount, size_t offset, size_t matchLen)
+{
+    if(out >= end) return 0;
+    size_t matchCode = matchLen ? matchLen - PACK_MIN_MATCH : 0;
+    u8 *token = out++;
+    *token = (u8)((min(literalCount, 15) << 4) | min(matchCode, 15));
+    if((literalCount >= 15) && !(out = PackPutLength(out, end, literalCount - 15))) return 0;
+    if((size_t)(end - out) < literalCount + 2) return 0;
+    memcpy(out, literals, literalCount);
+    out += literalCount;
+    if(matchLen) {
+        out[0] = (u8)offset;
+        out[1] = (u8)(offset >> 8);
+        out += 2;
+        if((matchCode >= 15) && !(out = PackPutLength(out, end, matchCode - 15))) return 0;
+    }
+    return out;
+}
+
+// LZ4 style sequences: [literal count << 4 | match length - 4] [literals] [u16 offset],
+// counts of 15 or more continue in the next bytes. The last sequence only has literals.
+// Returns 0 if it didn't fit in dstCap
+size_t PackCompress(const u8 *src, size_t size, u8 *dst, size_t dstCap)
+{
+    Assert(size < 0xFFFFFFFF);
+    u32 *table = (u32*)VL_REALLOC(0, sizeof(u32) << PACK_HASH_BITS);
+    Assert(table != NULL && "Buy more RAM lol!!");
+    memset(table, 0, sizeof(u32) << PACK_HASH_BITS);
+
+    u8 *out = dst;
+    u8 *end = dst + dstCap;
+    size_t anchor = 0;
+    size_t pos = 0;
+    while(out && (pos + PACK_MIN_MATCH <= size)) {
+        u32 h = PackHash(src + pos);
+        size_t candidate = table[h]; // position + 1, 0 is empty
+        table[h] = (u32)(pos + 1);
+        if(!candidate || (pos - (candidate - 1) > 0xFFFF) || memcmp(src + candidate - 1, src + pos, PACK_MIN_MATCH)) {
+            pos++;
+            continue;
+        }
+        candidate--;
+
+        size_t matchLen = PACK_MIN_MATCH;
+        while((pos + matchLen < size) && (src[candidate + matchLen] == src[pos + matchLen])) matchLen++;
+
+        out = PackPutSequence(out, end, src + anchor, pos - anchor, pos - candidate, matchLen);
+        pos += matchLen;
+        anchor = pos;
+    }
+    if(out) out = PackPutSequence(out, end, src + anchor, size - anchor, 0, 0);
+
+    VL_FREE(table);
+    return out ? (size_t)(out - dst) : 0;
+}
+
+// Checks every length since the pack could be corrupted
+bool PackDecompress(const u8 *src, size_t srcSize, u8 *dst, size_t dstSize)
+{
+    const u8 *in = src;
+    const u8 *inEnd = src + srcSize;
+    u8 *out = dst;
+    u8 *outEnd = dst + dstSize;
+    while(in < inEnd) {
+        u8 token = *in++;
+
+        size_t literalCount = token >> 4;
+        if(literalCount == 15) {
+            u8 b;
+            do {
+                if(in >= inEnd) return false;
+                b = *in++;
+                literalCount += b;
+            } while(b == 255);
+        }
+        if(((size_t)(inEnd - in) < literalCount) || ((size_t)(outEnd - out) < literalCount)) return false;
+        memcpy(out, in, literalCount);
+        in += literalCount;
+        out += literalCount;
+        if(in == inEnd) break;
+
+        if(inEnd - in < 2) return false;
+        size_t offset = (size_t)in[0] | ((size_t)in[1] << 8);
+        in += 2;
+        size_t matchLen = token & 15;
+        if(matchLen == 15) {
+            u8 b;
+            do {
+                if(in >= inEnd) return false;
+                b = *in++;
+                matchLen += b;
+            } while(b == 255);
+        }
+        matchLen += PACK_MIN_MATCH;
+        if(!offset || (offset > (size_t)(out - dst)) || ((size_t)(outEnd - out) < matchLen)) return false;
+
+        // NOTE: the match can overlap what it's writing
+        const u8 *match = out - offset;
+        for(size_t i = 0; i < matchLen; i++) out[i] = match[i];
+        out += matchLen;
+    }
+    return out == outEnd;
+}
+
+int PackCompareNames(const void *a, const void *b)
+{
+    return strcmp(*(const char**)a, *(const char**)b);
+}
+
+// Every file in template_files plus viclib.h and vl_build.h, packed into out
+bool BuildPack(string_builder *out)
+{
+    bool result = true;
+    size_t mark = temp_save();
+    vl_file_paths files = {0};
+    string_builder file = {0};
+    string_builder names = {0};
+    string_builder data = {0};
+    u8 *packed = 0;
+    pack_entry *entries = 0;
+
+    if(!VL_ReadDirectoryFilesRecursively(temp_sprintf("%s/template_files", selfPath), &files)) VL_ReturnDefer(false);
+    DaAppend(&files, temp_sprintf("%s/viclib.h", selfPath));
+    DaAppend(&files, temp_sprintf("%s/vl_build.h", selfPath));
+    size_t prefixLen = strlen(selfPath) + 1;
+    for(size_t i = 0; i < files.count; i++) files.items[i] += prefixLen;
+    qsort(files.items, files.count, sizeof(*files.items), PackCompareNames);
+
+    entries = (pack_entry*)VL_REALLOC(0, files.count*sizeof(pack_entry));
+    Assert(entries != NULL && "Buy more RAM lol!!");
+    u64 dataOffset = sizeof(pack_header) + files.count*sizeof(pack_entry);
+    for(size_t i = 0; i < files.count; i++) {
+        file.count = 0;
+        if(!SbReadEntireFile(temp_sprintf("%s/%s", selfPath, files.items[i]), &file)) VL_ReturnDefer(false);
+
+        pack_entry *entry = &entries[i];
+        entry->nameOffset = (u32)names.count;
+        entry->nameLen = (u32)strlen(files.items[i]);
+        SbAppendCstr(&names, files.items[i]);
+        entry->offset = data.count;
+        entry->size = file.count;
+
+        // Only compressed if it saves at least an eighth, the rest gets written straight from the pack
+        packed = (u8*)VL_REALLOC(packed, file.count);
+        Assert((packed != NULL || !file.count) && "Buy more RAM lol!!");
+        size_t packedSize = PackCompress((u8*)file.items, file.count, packed, file.count - file.count/8);
+        if(packedSize) DaAppendMany(&data, (char*)packed, packedSize);
+        else DaAppendMany(&data, file.items, file.count);
+        entry->packedSize = packedSize ? packedSize : file.count;
+    }
+    dataOffset += names.count;
+    for(size_t i = 0; i < files.count; i++) entries[i].offset += dataOffset;
+
+    pack_header header = {.count = (u32)files.count, .namesSize = (u32)names.count};
+    memcpy(header.magic, PACK_MAGIC, sizeof(header.magic));
+
+    DaAppendMany(out, (char*)&header, sizeof(header));
+    DaAppendMany(out, (char*)entries, files.count*sizeof(pack_entry));
+    DaAppendMany(out, names.items, names.count);
+    DaAppendMany(out, data.items, data.count);
+
+defer:
+    VL_FREE(entries);
+    VL_FREE(packed);
+    DaFree(files);
+    SbFree(file);
+    SbFree(names);
+    SbFree(data);
+    temp_rewind(mark);
+    return result;
+}
+
+// Written next to it and renamed so a template_engine running at the same time never sees half a file
+bool WriteFileAtomically(const char *path, const void *data, size_t size)
+{
+    size_t mark = temp_save();
+    const char *partial = temp_sprintf("%s.partial", path);
+    bool ok = WriteEntireFile(partial, data, size);
+    if(!ok) VL_Log(VL_ERROR, "Could not write %s: %s", partial, VL_GetError());
+    else ok = VL_Rename(partial, path);
+    if(!ok) remove(partial);
+    temp_rewind(mark);
+    return ok;
+}
+
+bool WritePack(const char *path)
+{
+    string_builder sb = {0};
+    bool ok = BuildPack(&sb) && WriteFileAtomically(path, sb.items, sb.count);
+    if(ok) VL_Log(VL_INFO, "Packed %u files into %s (%zu bytes)", ((pack_header*)sb.items)->count, path, sb.count);
+    SbFree(sb);
+    return ok;
+}
+
+bool UsePack(vl_mapped_file map)
+{
+    pack_header *header = (pack_header*)map.Data;
+    if((map.Size < sizeof(pack_header)) || memcmp(header->magic, PACK_MAGIC, sizeof(header->magic)) ||
+       ((map.Size - sizeof(pack_header))/sizeof(pack_entry) < header->count) ||
+       (map.Size - sizeof(pack_header) - header->count*sizeof(pack_entry) < header->namesSize))
+    {
+        return false;
+    }
+
+    pack = (template_pack){
+        .map = map,
+        .count = header->count,
+        .entries = (pack_entry*)(map.Data + sizeof(pack_header)),
+    };
+    pack.names = (const char*)(pack.entries + header->count);
+    return true;
+}
+
+bool OpenPack(const char *path)
+{
+    vl_mapped_file map;
+    if(!VL_MapFile(&map, path)) return false;
+    if(!UsePack(map)) {
+        VL_Log(VL_WARNING, "%s is not a valid template pack, using template_files instead", path);
+        VL_UnmapFile(&map);
+        return false;
+    }
+    return true;
+}
+
+view PackEntryName(pack_entry *entry)
+{
+    return ViewFromParts(pack.names + entry->nameOffset, entry->nameLen);
+}
+
+// Used for the perfect hash of the embedded pack, it has to give the same results when
+// generating it and when using it, so it's not VL_Hash64 which changes with SIMD support
+u64 EmbedHash(view name, u64 seed)
+{
+    u64 hash = 0xcbf29ce484222325ull ^ (seed*0x9E3779B97F4A7C15ull);
+    for(size_t i = 0; i < name.count; i++) {
+        hash ^= (u8)name.items[i];
+        hash *= 0x100000001b3ull;
+    }
+    hash ^= hash >> 32;
+    hash *= 0xd6e8feb86659fd93ull;
+    hash ^= hash >> 32;
+    return hash;
+}
+
+typedef struct {
+    u32 bucket;
+    u32 count;
+} embed_bucket;
+
+int EmbedCompareBuckets(const void *a, const void *b)
+{
+    const embed_bucket *x = (const embed_bucket*)a;
+    const embed_bucket *y = (const embed_bucket*)b;
+    if(x->count != y->count) return (x->count > y->count) ? -1 : 1;
+    return (x->bucket < y->bucket) ? -1 : (x->bucket > y->bucket);
+}
+
+// Hash and displace: the names get split in buckets of ~4 and each bucket gets the first seed
+// that puts all of its names in free slots. Biggest buckets go first since they're the hardest to fit.
+// slots[slot] is the entry index or 0xFFFF, doesn't fail unless there are more than 0xFFFF entries
+bool BuildPerfectHash(u32 *seeds, u32 bucketCount, u16 *slots, u32 slotCount)
+{
+    u32 *entryBuckets = (u32*)VL_REALLOC(0, (pack.count + 1)*sizeof(u32));
+    embed_bucket *buckets = (embed_bucket*)VL_REALLOC(0, bucketCount*sizeof(embed_bucket));
+    u32 *placed = (u32*)VL_REALLOC(0, (pack.count + 1)*sizeof(u32));
+    Assert(entryBuckets != NULL && buckets != NULL && placed != NULL && "Buy more RAM lol!!");
+
+    for(u32 b = 0; b < bucketCount; b++) buckets[b] = (embed_bucket){.bucket = b};
+    for(u32 i = 0; i < pack.count; i++) {
+        entryBuckets[i] = (u32)(EmbedHash(PackEntryName(&pack.entries[i]), 0) % bucketCount);
+        buckets[entryBuckets[i]].count++;
+    }
+    qsort(buckets, bucketCount, sizeof(*buckets), EmbedCompareBuckets);
+    memset(slots, 0xFF, slotCount*sizeof(u16));
+    memset(seeds, 0, bucketCount*sizeof(u32));
+
+    bool ok = true;
+    for(u32 b = 0; ok && (b < bucketCount) && (buckets[b].count > 0); b++) {
+        u32 bucket = buckets[b].bucket;
+        bool fits = false;
+        for(u32 seed = 1; !fits && (seed < (1u << 20)); seed++) {
+            u32 placedCount = 0;
+            fits = true;
+            for(u32 i = 0; fits && (i < pack.count); i++) {
+                if(entryBuckets[i] != bucket) continue;
+                u32 slot = (u32)(EmbedHash(PackEntryName(&pack.entries[i]), seed) & (slotCount - 1));
+                if(slots[slot] != 0xFFFF) fits = false;
+                else {
+                    slots[slot] = (u16)i;
+                    placed[placedCount++] = slot;
+                }
+            }
+            if(fits) seeds[bucket] = seed;
+            else for(u32 i = 0; i < placedCount; i++) slots[placed[i]] = 0xFFFF;
+        }
+        ok = fits;
+    }
+
+    VL_FREE(entryBuckets);
+    VL_FREE(buckets);
+    VL_FREE(placed);
+    return ok;
+}
+
+// Makes templates_embed.h, which gets compiled in with TEMPLATE_EMBED
+bool WriteEmbedHeader(const char *path)
+{
+    bool result = true;
+    string_builder packed = {0};
+    string_builder sb = {0};
+    u32 *seeds = 0;
+    u16 *slots = 0;
+    template_pack prevPack = pack;
+
+    if(!BuildPack(&packed)) VL_ReturnDefer(false);
+    if(!UsePack((vl_mapped_file){.Data = (u8*)packed.items, .Size = packed.count})) VL_ReturnDefer(false);
+    AssertMsg(pack.count < 0xFFFF, "Too many files for the embedded perfect hash");
+
+    u32 bucketCount = max(pack.count/4, 1u);
+    u32 slotCount = 1;
+    while(slotCount < pack.count) slotCount *= 2;
+    for(;;) {
+        seeds = (u32*)VL_REALLOC(seeds, bucketCount*sizeof(u32));
+        slots = (u16*)VL_REALLOC(slots, slotCount*sizeof(u16));
+        Assert(seeds != NULL && slots != NULL && "Buy more RAM lol!!");
+        if(BuildPerfectHash(seeds, bucketCount, slots, slotCount)) break;
+        slotCount *= 2;
+    }
+
+    SbAppendf(&sb, "// Generated by template_engine from template_files, don't edit\n");
+    SbAppendf(&sb, "#define TEMPLATE_EMBED_PACK_SIZE %zu\n", packed.count);
+    SbAppendf(&sb, "#define TEMPLATE_EMBED_BUCKET_COUNT %u\n", bucketCount);
+    SbAppendf(&sb, "#define TEMPLATE_EMBED_SLOT_COUNT %u\n\n", slotCount);
+
+    SbAppendCstr(&sb, "static const u32 templateEmbedSeeds[TEMPLATE_EMBED_BUCKET_COUNT] = {");
+    for(u32 i = 0; i < bucketCount; i++) SbAppendf(&sb, "%s%u,", (i % 16) ? "" : "\n    ", seeds[i]);
+    SbAppendCstr(&sb, "\n};\n\n");
+    SbAppendCstr(&sb, "static const u16 templateEmbedSlots[TEMPLATE_EMBED_SLOT_COUNT] = {");
+    for(u32 i = 0; i < slotCount; i++) SbAppendf(&sb, "%s%u,", (i % 16) ? "" : "\n    ", slots[i]);
+    SbAppendCstr(&sb, "\n};\n\n");
+
+    // NOTE: in a union so the pack is aligned for its u64s, + 1 for the string's null terminator
+    SbAppendCstr(&sb, "static const union { u8 bytes[TEMPLATE_EMBED_PACK_SIZE + 1]; u64 align; } templateEmbedPack = {");
+#if COMPILER_CL
+    // msvc can't have string literals this long, it gets a list of numbers which is a lot slower to compile
+    SbAppendCstr(&sb, "{");
+    for(size_t i = 0; i < packed.count; i++) {
+        if(!(i % 32)) SbAppendCstr(&sb, "\n    ");
+        char digits[4];
+        int n = 0;
+        u8 byte = (u8)packed.items[i];
+        do { digits[n++] = (char)('0' + byte % 10); byte /= 10; } while(byte);
+        while(n > 0) DaAppend(&sb, digits[--n]);
+        DaAppend(&sb, ',');
+    }
+    SbAppendCstr(&sb, "\n}};\n");
+#else
+    for(size_t i = 0; i < packed.count; i++) {
+        if(!(i % 128)) SbAppendCstr(&sb, i ? "\"\n    \"" : "\n    \"");
+        u8 byte = (u8)packed.items[i];
+        // NOTE: always 3 octal digits so a digit after it isn't read as part of it, '?' for trigraphs
+        if((byte >= ' ') && (byte <= '~') && (byte != '"') && (byte != '\\') && (byte != '?')) {
+            DaAppend(&sb, (char)byte);
+        } else {
+            char escape[4] = {'\\', (char)('0' + (byte >> 6)), (char)('0' + ((byte >> 3) & 7)), (char)('0' + (byte & 7))};
+            DaAppendMany(&sb, escape, sizeof(escape));
+        }
+    }
+    SbAppendCstr(&sb, "\"\n};\n");
+#endif
+
+    if(!WriteFileAtomically(path, sb.items, sb.count)) VL_ReturnDefer(false);
+    VL_Log(VL_INFO, "Embedded %u files into %s (%zu bytes packed, %u slots)", pack.count, path, packed.count, slotCount);
+
+defer:
+    pack = prevPack;
+    VL_FREE(seeds);
+    VL_FREE(slots);
+    SbFree(packed);
+    SbFree(sb);
+    return result;
+}
+
+// First entry with a name not smaller than name
+size_t PackLowerBound(view name)
+{
+    size_t lo = 0, hi = pack.count;
+    while(lo < hi) {
+        size_t mid = lo + (hi - lo)/2;
+        view midName = PackEntryName(&pack.entries[mid]);
+        int cmp = memcmp(midName.items, name.items, min(midName.count, name.count));
+        if((cmp < 0) || ((cmp == 0) && (midName.count < name.count))) lo = mid + 1;
+        else hi = mid;
+    }
+    return lo;
+}
+
+pack_entry *PackFind(const char *name)
+{
+    view nameView = ViewFromCstr(name);
+    if(pack.slots) {
+        u32 bucket = (u32)(EmbedHash(nameView, 0) % pack.bucketCount);
+        u16 i = pack.slots[EmbedHash(nameView, pack.seeds[bucket]) & (pack.slotCount - 1)];
+        if((i < pack.count) && ViewEq(PackEntryName(&pack.entries[i]), nameView)) return &pack.entries[i];
+        return 0;
+    }
+
+    size_t i = PackLowerBound(nameView);
+    if((i < pack.count) && ViewEq(PackEntryName(&pack.entries[i]), nameView)) return &pack.entries[i];
+    return 0;
+}
+
+// Calls proc with the decompressed contents, which are straight from the mapping when they weren't compressed
+bool PackRead(pack_entry *entry, bool (*proc)(const u8 *data, size_t size, void *user), void *user)
+{
+    view name = PackEntryName(entry);
+    if((entry->offset > pack.map.Size) || (pack.map.Size - entry->offset < entry->packedSize)) {
+        VL_Log(VL_ERROR, "Template pack is corrupted at '"VIEW_FMT"'", VIEW_ARG(name));
+        return false;
+    }
+    const u8 *data = pack.map.Data + entry->offset;
+    if(entry->packedSize == entry->size) return proc(data, entry->size, user);
+
+    u8 *unpacked = (u8*)VL_REALLOC(0, entry->size);
+    Assert(unpacked != NULL && "Buy more RAM lol!!");
+    bool ok = PackDecompress(data, entry->packedSize, unpacked, entry->size);
+    if(!ok) VL_Log(VL_ERROR, "Template pack is corrupted at '"VIEW_FMT"'", VIEW_ARG(name));
+    else ok = proc(unpacked, entry->size, user);
+    VL_FREE(unpacked);
+    return ok;
+}
+
+bool PackWriteProc(const u8 *data, size_t size, void *user)
+{
+    const char *dst = (const char*)user;
+    if(!WriteEntireFile(dst, data, size)) {
+        VL_Log(VL_ERROR, "Could not write %s: %s", dst, VL_GetError());
+        return false;
+    }
+    return true;
+}
+
+bool PackAppendProc(const u8 *data, size_t size, void *user)
+{
+    DaAppendMany((string_builder*)user, (const char*)data, size);
+    return true;
+}
+
+// name is relative to selfPath, read from the pack if there is one
+bool ReadTemplateFile(const char *name, string_builder *sb)
+{
+    if(pack.map.Data) {
+        pack_entry *entry = PackFind(name);
+        if(!entry) {
+            VL_Log(VL_ERROR, "'%s' is not in the template pack", name);
+            return false;
+        }
+        return PackRead(entry, PackAppendProc, sb);
+    }
+    return SbReadEntireFile(temp_sprintf("%s/%s", selfPath, name), sb);
+}
+
+// The embedded templates come first, then templates.pack. Neither is used when linking
+// since links need the files in template_files
+void LoadPack(void)
+{
+    static bool tried = false;
+    if(tried) return;
+    tried = true;
+
+    if((linkMode != VL_LINK_NONE) && (VL_GetFileType(temp_sprintf("%s/template_files", selfPath)) == VL_FILE_DIRECTORY)) return;
+
+#if defined(TEMPLATE_EMBED_PACK_SIZE)
+    if(UsePack((vl_mapped_file){.Data = (u8*)templateEmbedPack.bytes, .Size = TEMPLATE_EMBED_PACK_SIZE})) {
+        pack.seeds = templateEmbedSeeds;
+        pack.bucketCount = TEMPLATE_EMBED_BUCKET_COUNT;
+        pack.slots = templateEmbedSlots;
+        pack.slotCount = TEMPLATE_EMBED_SLOT_COUNT;
+        return;
+    }
+#endif
+
+    const char *path = temp_sprintf("%s/%s", selfPath, PACK_FILE_NAME);
+    if(!VL_FileExists(path)) return;
+    if(OpenPack(path)) VL_Log(VL_INFO, "Using %s", path);
+}
+
+// Only checked in the executable's directory, where the templates get edited
+bool PackIsStale(const char *path)
+{
+    size_t mark = temp_save();
+    vl_file_paths files = {0};
+    bool stale = true;
+    if(VL_ReadDirectoryFilesRecursively(temp_sprintf("%s/template_files", selfPath), &files)) {
+        DaAppend(&files, temp_sprintf("%s/viclib.h", selfPath));
+        DaAppend(&files, temp_sprintf("%s/vl_build.h", selfPath));
+        stale = VL_NeedsRebuild_Impl(path, files.items, files.count) != 0;
+    }
+    DaFree(files);
+    temp_rewind(mark);
+    return stale;
+}
+
+bool CopyTemplateFile(const char *name, const char *dst, vl_link_mode mode)
+{
+    if(pack.map.Data) {
+        pack_entry *entry = PackFind(name);
+        if(!entry) {
+            VL_Log(VL_ERROR, "'%s' is not in the template pack", name);
+            return false;
+        }
+        VL_Log(VL_ECHO, "extracting %s -> %s", name, dst);
+        return PackRead(entry, PackWriteProc, (void*)dst);
+    }
+    return VL_LinkOrCopyFile(temp_sprintf("%s/%s", selfPath, name), dst, mode);
+}
+
+bool CopyTemplateDirectory(const char *name, const char *dst, vl_link_mode mode)
+{
+    if(!pack.map.Data) {
+        return VL_CopyDirectoryRecursively(temp_sprintf("%s/%s", selfPath, name), dst, .link = mode);
+    }
+
+    VL_Log(VL_ECHO, "extracting %s/* -> %s", name, dst);
+    bool result = true;
+    size_t mark = temp_save();
+    if(!MkdirIfNotExist(dst)) VL_ReturnDefer(false);
+
+    // The entries are sorted, so everything in the directory comes one after the other
+    view prefix = ViewFromCstr(temp_sprintf("%s/", name));
+    view lastDir = {0};
+    vl_log_level prevLogLevel = VL_MinimalLogLevel;
+    for(size_t i = PackLowerBound(prefix); i < pack.count; i++) {
+        view entryName = PackEntryName(&pack.entries[i]);
+        if(!ViewStartsWith(entryName, prefix)) break;
+        view relative = ViewFromParts(entryName.items + prefix.count, entryName.count - prefix.count);
+
+        // Make the subdirectories once, not for every file in them
+        size_t dirLen = relative.count;
+        while(dirLen > 0 && relative.items[dirLen - 1] != '/') dirLen--;
+        view dir = ViewFromParts(relative.items, dirLen);
+        if(dirLen > 0 && !ViewEq(dir, lastDir)) {
+            for(size_t j = 0; j < dirLen; j++) {
+                if(relative.items[j] != '/') continue;
+                VL_MinimalLogLevel = VL_WARNING;
+                bool ok = MkdirIfNotExist(temp_sprintf("%s/%.*s", dst, (int)j, relative.items));
+                VL_MinimalLogLevel = prevLogLevel;
+                if(!ok) VL_ReturnDefer(false);
+            }
+            lastDir = dir;
+        }
+
+        const char *dstFile = temp_sprintf("%s/%.*s", dst, (int)relative.count, relative.items);
+        if(!PackRead(&pack.entries[i], PackWriteProc, (void*)dstFile)) VL_ReturnDefer(false);
+    }
+
+defer:
+    temp_rewind(mark);
+    return result;
+}
+
 void GetInfo(Template t)
 {
     fprintf(stderr, "[INFO] '%s':\n", TemplateToString(t));
+    LoadPack();
     string_builder sb = {0};
-    char *readmeFileFmt = 0;
+    char *readmeFile = 0;
     
     switch(t) {
         case Template_SDL3: {
-            readmeFileFmt = "%s/template_files/SDL3/README.md";
+            readmeFile = "template_files/SDL3/README.md";
         } break;
         case Template_SDL3_Hotreload: {
-            readmeFileFmt = "%s/template_files/SDL3/README_hotreload.md";
+            readmeFile = "template_files/SDL3/README_hotreload.md";
         } break;
         case Template_SDL3_GPU_Hotreload: {
-            readmeFileFmt = "%s/template_files/SDL3/README_gpu.md";
+            readmeFile = "template_files/SDL3/README_gpu.md";
         } break;
         
         case Template_None: case Count_Templates: Assert(!"unreachable");
     }
 
-    if(!readmeFileFmt) {
+    if(!readmeFile) {
         fprintf(stderr, "Missing info for this template, make an issue on github: https://github.com/victor-Lopez25/template_engine/issues\n");
         return;
     }
-    SbReadEntireFile(temp_sprintf("%s/template_files/SDL3/README.md", selfPath), &sb);
+    if(!ReadTemplateFile(readmeFile, &sb)) return;
     fprintf(stderr, "%.*s\n\n", (int)sb.count, sb.items);
 }
 
@@ -108,17 +756,17 @@ void SetupGeneralSDL3Templates_(const char **libs, size_t libcount)
     size_t mark = temp_save();
 
     for(size_t i = 0; i < libcount; i++) {
-        VL_CopyFile(temp_sprintf("%s/template_files/SDL3/bin/%s.dll", selfPath, libs[i]), temp_sprintf("dependencies/%s.dll", libs[i]));
-        VL_CopyFile(temp_sprintf("%s/template_files/SDL3/lib/%s.lib", selfPath, libs[i]), temp_sprintf("lib/%s.lib", libs[i]));
+        CopyTemplateFile(temp_sprintf("template_files/SDL3/bin/%s.dll", libs[i]), temp_sprintf("dependencies/%s.dll", libs[i]), linkMode);
+        CopyTemplateFile(temp_sprintf("template_files/SDL3/lib/%s.lib", libs[i]), temp_sprintf("lib/%s.lib", libs[i]), linkMode);
     }
 
-    VL_CopyDirectoryRecursively(temp_sprintf("%s/template_files/SDL3/include", selfPath), "include/SDL3");
+    CopyTemplateDirectory("template_files/SDL3/include", "include/SDL3", linkMode);
 
-    VL_CopyFile(temp_sprintf("%s/template_files/spall.h", selfPath), "src/spall.h");
-    VL_CopyFile(temp_sprintf("%s/viclib.h", selfPath), "src/viclib.h");
-    VL_CopyFile(temp_sprintf("%s/vl_build.h", selfPath), "vl_build.h");
-    VL_CopyFile(temp_sprintf("%s/template_files/SDL3/sdl_common.h", selfPath), "src/sdl_common.h");
-    VL_CopyFile(temp_sprintf("%s/template_files/SDL3/sdl_common.c", selfPath), "src/sdl_common.c");
+    CopyTemplateFile("template_files/spall.h", "src/spall.h", linkMode);
+    CopyTemplateFile("viclib.h", "src/viclib.h", linkMode);
+    CopyTemplateFile("vl_build.h", "vl_build.h", linkMode);
+    CopyTemplateFile("template_files/SDL3/sdl_common.h", "src/sdl_common.h", VL_LINK_NONE);
+    CopyTemplateFile("template_files/SDL3/sdl_common.c", "src/sdl_common.c", VL_LINK_NONE);
 
     temp_rewind(mark);
 }
@@ -128,132 +776,47 @@ void DoTemplate(Template chosen)
     Assert(chosen > Template_None || chosen < Count_Templates);
 
     VL_Log(VL_INFO, "Chosen template: %s\n", TemplateToString(chosen));
+    LoadPack();
     switch(chosen) {
         case Template_SDL3: {
             // SDL3_mixer also?
             SetupGeneralSDL3Templates("SDL3_image", "SDL3_ttf");
 
-            VL_CopyFile(temp_sprintf("%s/template_files/SDL3/main.c", selfPath), "src/main.c");
-            VL_CopyFile(temp_sprintf("%s/template_files/SDL3/build.c", selfPath), "build.c");
-            VL_CopyFile(temp_sprintf("%s/template_files/SDL3/README.md", selfPath), "README.md");
+            CopyTemplateFile("template_files/SDL3/main.c", "src/main.c", VL_LINK_NONE);
+            CopyTemplateFile("template_files/SDL3/build.c", "build.c", VL_LINK_NONE);
+            CopyTemplateFile("template_files/SDL3/README.md", "README.md", VL_LINK_NONE);
         } break;
 
         case Template_SDL3_Hotreload: {
             // SDL3_mixer also?
             SetupGeneralSDL3Templates("SDL3_image", "SDL3_ttf");
 
-            VL_CopyFile(temp_sprintf("%s/template_files/main_hot_reload.c", selfPath), "src/main_hot_reload.c");
-            VL_CopyFile(temp_sprintf("%s/template_files/main_no_hot_reload.c", selfPath), "src/main_no_hot_reload.c");
-            VL_CopyFile(temp_sprintf("%s/template_files/SDL3/app.c", selfPath), "src/app.c");
-            VL_CopyFile(temp_sprintf("%s/template_files/SDL3/build_hotreload.c", selfPath), "build.c");
-            VL_CopyFile(temp_sprintf("%s/template_files/SDL3/README_hotreload.md", selfPath), "README.md");
+            CopyTemplateFile("template_files/main_hot_reload.c", "src/main_hot_reload.c", VL_LINK_NONE);
+            CopyTemplateFile("template_files/main_no_hot_reload.c", "src/main_no_hot_reload.c", VL_LINK_NONE);
+            CopyTemplateFile("template_files/SDL3/app.c", "src/app.c", VL_LINK_NONE);
+            CopyTemplateFile("template_files/SDL3/build_hotreload.c", "build.c", VL_LINK_NONE);
+            CopyTemplateFile("template_files/SDL3/README_hotreload.md", "README.md", VL_LINK_NONE);
         } break;
 
         case Template_SDL3_GPU_Hotreload: {
             SetupGeneralSDL3Templates("SDL3_image", "SDL3_ttf", "SDL3_shadercross");
 
-            VL_CopyDirectoryRecursively(temp_sprintf("%s/template_files/SDL3/shaders", selfPath), "shaders");
+            CopyTemplateDirectory("template_files/SDL3/shaders", "shaders", VL_LINK_NONE);
 
-            VL_CopyFile(temp_sprintf("%s/template_files/main_hot_reload.c", selfPath), "src/main_hot_reload.c");
-            VL_CopyFile(temp_sprintf("%s/template_files/main_no_hot_reload.c", selfPath), "src/main_no_hot_reload.c");
-            VL_CopyFile(temp_sprintf("%s/template_files/SDL3/app_gpu.c", selfPath), "src/app.c");
-            VL_CopyFile(temp_sprintf("%s/template_files/SDL3/build_gpu.c", selfPath), "build.c");
-            VL_CopyFile(temp_sprintf("%s/template_files/SDL3/README_gpu.md", selfPath), "README.md");
+            CopyTemplateFile("template_files/main_hot_reload.c", "src/main_hot_reload.c", VL_LINK_NONE);
+            CopyTemplateFile("template_files/main_no_hot_reload.c", "src/main_no_hot_reload.c", VL_LINK_NONE);
+            CopyTemplateFile("template_files/SDL3/app_gpu.c", "src/app.c", VL_LINK_NONE);
+            CopyTemplateFile("template_files/SDL3/build_gpu.c", "build.c", VL_LINK_NONE);
+            CopyTemplateFile("template_files/SDL3/README_gpu.md", "README.md", VL_LINK_NONE);
 
             MkdirIfNotExist("resources");
-            VL_CopyFile(temp_sprintf("%s/template_files/resources/cat.jpg", selfPath), "resources/cat.jpg");
+            CopyTemplateFile("template_files/resources/cat.jpg", "resources/cat.jpg", VL_LINK_NONE);
         } break;
 
         case Template_None: case Count_Templates: break;
     }
 }
 
-bool TestTemplate(vl_cmd *cmd, Template chosen)
-{
-    Assert(chosen > Template_None || chosen < Count_Templates);
-
-#define X(...) { \
-    .items = (const char*[]){__VA_ARGS__}, \
-    .count = (sizeof((const char*[]){__VA_ARGS__})/sizeof(const char*)) }
-        struct { const char **items; size_t count; } cmdItems[] = {
-#if defined(_WIN32)
-            X("gcc", "build.c", "-o", "build.exe", "-Wall", "-Wextra", "-Werror"),
-            X("clang", "build.c", "-o", "build.exe", "-Wall", "-Wextra", "-Werror"),
-            X("cl", "build.c", "/nologo", "-FC", "-GR-", "-EHa", "-W4", "-WX", "-D_CRT_SECURE_NO_WARNINGS"),
-#else
-            X("cc", "build.c", "-o", "build", "-Wall", "-Wextra", "-Werror"),
-#endif
-        };
-#undef X
-
-    switch(chosen) {
-        case Template_SDL3: {
-            for(size_t i = 0; i < ArrayLen(cmdItems); i++) {
-                DaAppendMany(cmd, cmdItems[i].items, cmdItems[i].count);
-                if(!CmdRun(cmd)) return false;
-                CmdAppend(cmd, "build", "test");
-                if(!CmdRun(cmd)) return false;
-            }
-        } break;
-
-        case Template_SDL3_Hotreload:
-        case Template_SDL3_GPU_Hotreload: {
-            for(size_t i = 0; i < ArrayLen(cmdItems); i++) {
-                DaAppendMany(cmd, cmdItems[i].items, cmdItems[i].count);
-                if(!CmdRun(cmd)) return false;
-                CmdAppend(cmd, "build", "test", "hotreload");
-                if(!CmdRun(cmd)) return false;
-                CmdAppend(cmd, "build", "test", "nohotreload");
-                if(!CmdRun(cmd)) return false;
-            }
-        } break;
-
-        case Template_None: case Count_Templates: return false;
-    }
-
-    return true;
-}
-
-bool RemoveDirectoryRecursive(const char *dir)
-{
-    file_type type = VL_GetFileType(dir);
-    if(type == VL_FILE_DIRECTORY) { // directory
-        vl_file_paths paths = {0};
-        size_t mark = temp_save();
-        VL_ReadEntireDir(dir, &paths);
-        for(size_t pathIdx = 0; pathIdx < paths.count; pathIdx++)
-        {
-            if(strcmp(paths.items[pathIdx], ".") && strcmp(paths.items[pathIdx], "..")) {
-                if(!RemoveDirectoryRecursive(temp_sprintf("%s/%s", dir, paths.items[pathIdx]))) {
-                    VL_FREE(paths.items);
-                    temp_rewind(mark);
-                    return false;
-                }
-            }
-        }
-        VL_FREE(paths.items);
-        temp_rewind(mark);
-#if defined(_WIN32)
-        return RemoveDirectoryA(dir);
-#else
-        return rmdir(dir) == 0;
-#endif
-    } else if(type == VL_FILE_REGULAR) { // normal file
-        return VL_DeleteFile(dir);
-    } else if(type == VL_FILE_SYMLINK) {
-#if defined(_WIN32)
-        VL_Log(VL_WARNING, "Symlink deleting is not supported on windows for now, skipped deleting '%s'", dir);
-        return true;
-#else
-        return unlink(dir) == 0;
-#endif
-    } else if(type == VL_FILE_OTHER) {
-        VL_Log(VL_WARNING, "Unknown file type of file '%s'", dir);
-        return true;
-    }
-    return false;
-}
-
 bool ConsoleSupportsColor(void)
 {
     static bool supports = false;
@@ -282,44 +845,168 @@ const char *SuccessOrFail(bool success)
     return success ? "success" : "fail";
 }
 
+#define X(...) { \
+    .items = (const char*[]){__VA_ARGS__}, \
+    .count = (sizeof((const char*[]){__VA_ARGS__})/sizeof(const char*)) }
+struct { const char **items; size_t count; } testCompilers[] = {
+#if defined(_WIN32)
+    X("gcc", "build.c", "-o", "build.exe", "-Wall", "-Wextra", "-Werror"),
+    X("clang", "build.c", "-o", "build.exe", "-Wall", "-Wextra", "-Werror"),
+    X("cl", "build.c", "/nologo", "-FC", "-GR-", "-EHa", "-W4", "-WX", "-D_CRT_SECURE_NO_WARNINGS"),
+#else
+    X("cc", "build.c", "-o", "build", "-Wall", "-Wextra", "-Werror", "-pthread"),
+#endif
+};
+#undef X
+
+// One template built with one compiler, in its own directory so it can run at the same time as the others
+typedef struct {
+    Template t;
+    size_t compiler; /* into testCompilers */
+    const char *dir; /* absolute */
+    size_t step; /* next command to run, see StartTestStep */
+    vl_proc proc; /* VL_INVALID_PROC when nothing is running */
+    bool started, finished, ok;
+    u64 start, end;
+} test_case;
+
+// Starts the next command of the test: building build.c, then running the build with each of its test arguments.
+// Returns false when there are no commands left
+bool StartTestStep(vl_cmd *cmd, test_case *tc, vl_procs *procs)
+{
+    // NOTE: absolute since windows doesn't look for the program in the working directory
+    const char *build = temp_sprintf("%s/build", tc->dir);
+    size_t step = tc->step++;
+    if(step == 0) {
+        DaAppendMany(cmd, testCompilers[tc->compiler].items, testCompilers[tc->compiler].count);
+    } else if(tc->t == Template_SDL3) {
+        if(step > 1) return false;
+        CmdAppend(cmd, build, "test");
+    } else {
+        if(step == 1) CmdAppend(cmd, build, "test", "hotreload");
+        else if(step == 2) CmdAppend(cmd, build, "test", "nohotreload");
+        else return false;
+    }
+
+    if(!CmdRun(cmd, .async = procs, .maxProcs = procs->count + 1, .captureOutput = true, .workingDir = tc->dir)) {
+        tc->ok = false;
+        return false;
+    }
+    tc->proc = procs->items[procs->count - 1];
+    return true;
+}
+
+void PrintTestResult(test_case *tc)
+{
+    printf("Test: %s (%s) - %s (%.2fs)\n", TemplateToString(tc->t), testCompilers[tc->compiler].items[0],
+           SuccessOrFail(tc->ok), (double)(tc->end - tc->start)/VL_NANOS_PER_SEC);
+    fflush(stdout);
+}
+
 void Test(void)
 {
     vl_cmd cmd = {0};
+    vl_procs procs = {0};
     bool returnOnFirstFail = true;
     bool success = true;
     VL_MinimalLogLevel = VL_ERROR;
-    RemoveDirectoryRecursive("temp");
-    for(int templateIdx = Template_None+1; templateIdx < Count_Templates; templateIdx++)
-    {
-        MkdirIfNotExist("temp");
-        VL_SetCurrentDir("temp");
+    VL_RemoveTree("temp", .parallel = true);
+    MkdirIfNotExist("temp");
+
+    // Made one after the other since DoTemplate works in the current directory, add 'hardlink' before 'test' to link instead of copying
+    const char *root = VL_temp_GetCurrentDir();
+    size_t caseCount = (Count_Templates - Template_None - 1)*ArrayLen(testCompilers);
+    test_case *cases = (test_case*)temp_alloc(caseCount*sizeof(test_case), .Alignment = 8);
+    size_t caseIdx = 0;
+    for(int templateIdx = Template_None+1; templateIdx < Count_Templates; templateIdx++) {
+        for(size_t compiler = 0; compiler < ArrayLen(testCompilers); compiler++) {
+            char *name = temp_sprintf("%s-%s", TemplateToString((Template)templateIdx), testCompilers[compiler].items[0]);
+            for(char *c = name; *c; c++) if(*c == ' ') *c = '_';
+
+            test_case *tc = &cases[caseIdx++];
+            *tc = (test_case){.t = (Template)templateIdx, .compiler = compiler, .proc = VL_INVALID_PROC, .ok = true};
+            tc->dir = temp_sprintf("%s/temp/%s", root, name);
+            MkdirIfNotExist(tc->dir);
+            VL_SetCurrentDir(tc->dir);
+            DoTemplate(tc->t);
+            VL_SetCurrentDir(root);
+        }
+    }
 
-        DoTemplate((Template)templateIdx);
-        VL_MinimalLogLevel = VL_INFO;
+    // Every case runs its commands one after the other, up to one case per core at the same time.
+    // The builds are parallel themselves, so they split the cores between them
+    VL_MinimalLogLevel = VL_INFO;
+    size_t cores = (size_t)VL_GetCountProcs();
+    size_t maxRunning = (cores < caseCount) ? cores : caseCount;
+    const char *jobs = temp_sprintf("%zu", (cores/maxRunning > 0) ? cores/maxRunning : 1);
+#if defined(_WIN32)
+    _putenv_s("VL_BUILD_JOBS", jobs);
+#else
+    setenv("VL_BUILD_JOBS", jobs, 1);
+#endif
+    size_t nextCase = 0;
+    u64 start = VL_TraceClock();
+    for(;;) {
+        while((procs.count < maxRunning) && (nextCase < caseCount) && (success || !returnOnFirstFail)) {
+            test_case *tc = &cases[nextCase++];
+            tc->started = true;
+            tc->start = VL_TraceClock();
+            if(!StartTestStep(&cmd, tc, &procs)) {
+                tc->finished = true;
+                tc->end = VL_TraceClock();
+                PrintTestResult(tc);
+                success = false;
+            }
+        }
+        if(procs.count == 0) break;
 
-        bool ok = TestTemplate(&cmd, (Template)templateIdx);
-        VL_MinimalLogLevel = VL_ERROR;
+        bool ok;
+        int i = VL_ProcsWaitAny(procs, -1, &ok);
+        if(i < 0) {
+            success = false;
+            break;
+        }
+        vl_proc proc = procs.items[i];
+        DaRemoveUnordered(&procs, i);
 
-        printf("Test: %s - %s\n", TemplateToString((Template)templateIdx), SuccessOrFail(ok));
-        VL_SetCurrentDir("..");
-        if(!ok) {
-            if(returnOnFirstFail) return;
-            else success = false;
+        test_case *tc = 0;
+        for(size_t c = 0; c < caseCount; c++) {
+            if(cases[c].started && !cases[c].finished && (cases[c].proc == proc)) tc = &cases[c];
+        }
+        Assert(tc);
+        tc->proc = VL_INVALID_PROC;
+        if(!ok) tc->ok = false;
+        if(!tc->ok || !StartTestStep(&cmd, tc, &procs)) {
+            tc->finished = true;
+            tc->end = VL_TraceClock();
+            PrintTestResult(tc);
+            if(!tc->ok) success = false;
         }
-        if(!RemoveDirectoryRecursive("temp")) return;
     }
-    printf("\nTests %s\n", SuccessOrFail(success));
+    u64 wall = VL_TraceClock() - start;
+
+    u64 total = 0;
+    for(size_t c = 0; c < caseCount; c++) {
+        if(cases[c].finished) total += cases[c].end - cases[c].start;
+        else printf("Test: %s (%s) - skipped\n", TemplateToString(cases[c].t), testCompilers[cases[c].compiler].items[0]);
+    }
+    printf("\nTests %s in %.2fs (%.2fs one after another)\n", SuccessOrFail(success),
+           (double)wall/VL_NANOS_PER_SEC, (double)total/VL_NANOS_PER_SEC);
+
+    // NOTE: the directories are kept when something failed to look at what happened
+    if(success) VL_RemoveTree("temp", .parallel = true);
+    CmdFree(cmd);
+    DaFree(procs);
 }
 
 int main(int argc, char **argv)
 {
     char *exe_path = VL_temp_RunningExecutablePath();
     selfPath = VL_temp_DirName(exe_path);
-    for(int i = (int)strlen(selfPath) - 1; i >= 0; i--) {
-        if(selfPath[i] == '/' || selfPath[i] == '\\') {
-            selfPath[i] = '\0';
-            break;
-        }
+    // NOTE: only the windows version of VL_temp_DirName keeps the last slash
+    size_t selfPathLen = strlen(selfPath);
+    if((selfPathLen > 1) && (selfPath[selfPathLen - 1] == '/' || selfPath[selfPathLen - 1] == '\\')) {
+        selfPath[selfPathLen - 1] = '\0';
     }
 
     const char *current_dir = VL_temp_GetCurrentDir();
@@ -348,13 +1035,34 @@ int main(int argc, char **argv)
                 gotInfo = true;
             }
             return 0;
+        } else if(!strcmp(arg, "pack")) {
+            if(gettingInfo) {
+                fprintf(stderr, "[INFO] 'pack': Packs every template into "PACK_FILE_NAME" next to the executable, "
+                                "it's used instead of template_files when it exists\n");
+                gotInfo = true;
+                continue;
+            }
+            return WritePack(temp_sprintf("%s/%s", selfPath, PACK_FILE_NAME)) ? 0 : 1;
         } else if(!strcmp(arg, "info")) {
             gettingInfo = true;
+        } else if(!strcmp(arg, "hardlink")) {
+            linkMode = VL_LINK_HARD;
+        } else if(!strcmp(arg, "symlink")) {
+            linkMode = VL_LINK_SYMBOLIC;
         }
     }
 
     if(inExeDirectory) {
+#if defined(TEMPLATE_EMBED)
+        // Generated before rebuilding so the new executable has the templates as they are now
+        const char *embedPath = temp_sprintf("%s/%s", selfPath, TEMPLATE_EMBED_FILE);
+        if(PackIsStale(embedPath)) WriteEmbedHeader(embedPath);
+        VL_GO_REBUILD_URSELF(argc, argv, TEMPLATE_EMBED_FILE);
+#else
         VL_GO_REBUILD_URSELF(argc, argv);
+#endif
+        const char *packPath = temp_sprintf("%s/%s", selfPath, PACK_FILE_NAME);
+        if(VL_FileExists(packPath) && PackIsStale(packPath)) WritePack(packPath);
 #if defined(_WIN32) && defined(SHORTCUT_PATH)
         size_t exe_name_len = strlen(argv[0]);
         if(exe_name_len < 5 || strcmp(argv[0] + exe_name_len - 4, ".exe")) {
@@ -29,6 +29,7 @@ typedef struct {
     SDL_GPUShader *shader;
     SDL_ShaderCross_GraphicsShaderMetadata *meta;
     const char *filename;
+    Uint64 watchBit; /* 0 when ProgramContext.shaderWatch couldn't be started */
     Uint64 fileTime;
 } ShaderInfo;
 
@@ -45,6 +46,7 @@ typedef struct {
     SDL_Mutex *mutex;
     SDL_GPUColorTargetDescription colorDesc;
     SDL_AtomicInt recompiling;
+    WorkGroup shaderGroup; // Both shaders of a recompile, the pipeline is built once it's done
 } PipelineCompileContext;
 
 // In case you want to disable this
@@ -95,6 +97,8 @@ struct ProgramContext {
     SDL_GPUTexture *depthTexture;
 
     WorkQueue workQueue;
+    vl_file_watch shaderWatch;
+    bool watchingShaders;
 
     SpallBuffer spall_buffer;
     SpallProfile spall_ctx;
@@ -312,14 +316,25 @@ bool CompileShader(SpallProfile *spall_ctx, SpallBuffer *spall_buffer, SDL_GPUDe
 SDL_GPUVertexElementFormat GPUVertexElementFormat_From_Metadata(SDL_ShaderCross_IOVarMetadata *meta);
 Uint32 GetGPUVariableSize_From_Metadata(SDL_ShaderCross_IOVarMetadata *meta);
 
-int PipelineFromShadersWork(SpallProfile *spall_ctx, SpallBuffer *spall_buffer, void *data)
+int CompileVertShaderWork(SpallProfile *spall_ctx, SpallBuffer *spall_buffer, void *data)
 {
-    Spall_BufferBegin(spall_ctx, spall_buffer, __FUNCTION__);
-
     PipelineCompileContext *info = (PipelineCompileContext*)data;
-
     CompileShader(spall_ctx, spall_buffer, info->ctx->gpu, &info->vert);
+    return 0;
+}
+
+int CompileFragShaderWork(SpallProfile *spall_ctx, SpallBuffer *spall_buffer, void *data)
+{
+    PipelineCompileContext *info = (PipelineCompileContext*)data;
     CompileShader(spall_ctx, spall_buffer, info->ctx->gpu, &info->frag);
+    return 0;
+}
+
+int BuildPipelineWork(SpallProfile *spall_ctx, SpallBuffer *spall_buffer, void *data)
+{
+    Spall_BufferBegin(spall_ctx, spall_buffer, __FUNCTION__);
+
+    PipelineCompileContext *info = (PipelineCompileContext*)data;
 
     info->info.vertex_shader = info->vert.shader;
     info->info.fragment_shader = info->frag.shader;
@@ -377,17 +392,31 @@ int PipelineFromShadersWork(SpallProfile *spall_ctx, SpallBuffer *spall_buffer,
     return 0;
 }
 
-void PipelineFromShaders(PipelineCompileContext *ctx, bool initTime)
+int PipelineFromShadersWork(SpallProfile *spall_ctx, SpallBuffer *spall_buffer, void *data)
 {
-    Uint64 currentFileTimeVert;
-    Uint64 currentFileTimeFrag;
+    CompileVertShaderWork(spall_ctx, spall_buffer, data);
+    CompileFragShaderWork(spall_ctx, spall_buffer, data);
+    return BuildPipelineWork(spall_ctx, spall_buffer, data);
+}
 
-    bool needRecompileVert = GetLastWriteTime(ctx->vert.filename, &currentFileTimeVert) && currentFileTimeVert != ctx->vert.fileTime;
-    ctx->vert.fileTime = currentFileTimeVert;
-    bool needRecompileFrag = GetLastWriteTime(ctx->frag.filename, &currentFileTimeFrag) && currentFileTimeFrag != ctx->frag.fileTime;
-    ctx->frag.fileTime = currentFileTimeFrag;
+void PipelineFromShaders(PipelineCompileContext *ctx, bool initTime)
+{
+    bool needRecompile;
+    if(ctx->vert.watchBit && ctx->frag.watchBit) {
+        // No syscalls unless the watch thread saw one of the shaders change
+        needRecompile = VL_WatchChanges(&ctx->ctx->shaderWatch, ctx->vert.watchBit | ctx->frag.watchBit) != 0;
+    } else {
+        Uint64 currentFileTimeVert;
+        Uint64 currentFileTimeFrag;
+
+        bool needRecompileVert = GetLastWriteTime(ctx->vert.filename, &currentFileTimeVert) && currentFileTimeVert != ctx->vert.fileTime;
+        ctx->vert.fileTime = currentFileTimeVert;
+        bool needRecompileFrag = GetLastWriteTime(ctx->frag.filename, &currentFileTimeFrag) && currentFileTimeFrag != ctx->frag.fileTime;
+        ctx->frag.fileTime = currentFileTimeFrag;
+        needRecompile = needRecompileVert || needRecompileFrag;
+    }
 
-    if(!initTime && !needRecompileVert && !needRecompileFrag) {
+    if(!initTime && !needRecompile) {
         return;
     }
 
@@ -395,7 +424,12 @@ void PipelineFromShaders(PipelineCompileContext *ctx, bool initTime)
         PipelineFromShadersWork(&ctx->ctx->spall_ctx, &ctx->ctx->spall_buffer, ctx);
     } else {
         if(!SDL_SetAtomicInt(&ctx->recompiling, 1)) {
-            AddWorkEntry(&ctx->ctx->workQueue, PipelineFromShadersWork, ctx);
+            // Both shaders compile at the same time, the pipeline waits for them
+            WorkQueue *queue = &ctx->ctx->workQueue;
+            WorkGroupBegin(&ctx->shaderGroup);
+            AddWorkEntryToGroup(queue, &ctx->shaderGroup, CompileVertShaderWork, ctx);
+            AddWorkEntryToGroup(queue, &ctx->shaderGroup, CompileFragShaderWork, ctx);
+            AddWorkEntryAfterGroup(queue, &ctx->shaderGroup, NULL, BuildPipelineWork, ctx);
         }
     }
 }
@@ -407,6 +441,11 @@ bool InitPipelineCompileContext_(ProgramContext *prog_ctx, PipelineCompileContex
     ctx->ctx = prog_ctx;
     ctx->vert.filename = vert;
     ctx->frag.filename = frag;
+    if(prog_ctx->watchingShaders) {
+        // Each pipeline gets its own bits even for the same files, VL_WatchChanges clears the ones it returns
+        ctx->vert.watchBit = VL_WatchFile(&prog_ctx->shaderWatch, vert);
+        ctx->frag.watchBit = VL_WatchFile(&prog_ctx->shaderWatch, frag);
+    }
     ctx->pipeline = pipeline;
     if(CheckVertexInstanceSize) ctx->CheckVertexInstanceSize = CheckVertexInstanceSize;
     else ctx->CheckVertexInstanceSize = CheckVertexInstanceSize_Default;
@@ -584,6 +623,11 @@ DLL_EXPORT bool AppInit(void *rawdata)
 
     ctx->swapchainTextureFormat = SDL_GetGPUSwapchainTextureFormat(ctx->gpu, ctx->window);
 
+    ctx->watchingShaders = VL_WatchInit(&ctx->shaderWatch);
+    if(!ctx->watchingShaders) {
+        SDL_Log("Could not start watching the shaders, checking their write time every frame instead");
+    }
+
     ctx->fillPipelineCompileCtx.info.rasterizer_state.fill_mode = SDL_GPU_FILLMODE_FILL;
 
     InitPipelineCompileContext(ctx, &ctx->fillPipelineCompileCtx, 
@@ -733,6 +777,7 @@ DLL_EXPORT void AppDeInit(void *rawdata)
 
     SDL_ShaderCross_Quit();
 
+    if(ctx->watchingShaders) VL_WatchEnd(&ctx->shaderWatch);
     FreePipelineCompileContext(&ctx->fillPipelineCompileCtx);
     FreePipelineCompileContext(&ctx->linePipelineCompileCtx);
     SDL_ReleaseGPUTransferBuffer(ctx->gpu, ctx->transferBuf);
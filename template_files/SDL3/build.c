@@ -24,7 +24,7 @@ int main(int argc, char **argv)
     }
 
     vl_cmd cmd = {0};
-    VL_CopyDirectoryRecursively("dependencies", "bin");
+    VL_CopyDirectoryRecursively("dependencies", "bin", .sync = true);
 
     vl_compile_ctx ctx = {
         .debug = false,
@@ -6,6 +6,13 @@
 # define OUT_DIRECTORY "bin"
 #endif
 
+// VL_WatchInit runs the file watch on a thread, glibc older than 2.34 needs pthread linked for it
+#if defined(_WIN32)
+# define THREAD_LIBS
+#else
+# define THREAD_LIBS , "pthread"
+#endif
+
 #if defined(_WIN32)
 #include <tlhelp32.h>
 bool ProgramAlreadyRunning(const char *program)
@@ -47,7 +54,7 @@ bool ProgramAlreadyRunning(const char *program)
 
     if(!(dir = opendir("/proc"))) {
         perror("can't open /proc");
-        return -1;
+        return false;
     }
 
     while((ent = readdir(dir)) != NULL) {
@@ -60,22 +67,19 @@ bool ProgramAlreadyRunning(const char *program)
 
         /* try to open the cmdline file */
         size_t mark = temp_save();
-        char *buf = temp_sprintf("/proc/%ld/cmdline", lpid);
-        FILE* fp = fopen(buf, "r");
+        FILE* fp = fopen(temp_sprintf("/proc/%ld/cmdline", lpid), "r");
         temp_rewind(mark);
 
         if(fp) {
-            if(fgets(buf, strlen(buf), fp) != NULL) {
-                /* check the first token in the file, the program name */
-                char *first = strtok(buf, " ");
-                if(!strcmp(first, name)) {
-                    fclose(fp);
-                    closedir(dir);
+            /* the arguments are separated by '\0', so buf is argv[0] */
+            if(fgets(buf, sizeof(buf), fp) != NULL) {
+                if(!strcmp(VL_PathName(buf), program)) {
                     running = true;
                 }
             }
             fclose(fp);
         }
+        if(running) break;
     }
 
     closedir(dir);
@@ -83,29 +87,36 @@ bool ProgramAlreadyRunning(const char *program)
 }
 #endif
 
-bool CompileApp(vl_cmd *cmd, bool warningsAsErrors)
-{
-    vl_compile_ctx ctx = {
-        .type = Compile_DynamicLibrary,
-        .debug = false,
-        .gcSections = true,
-        .warnings = true,
-        .warningsAsErrors = warningsAsErrors,
-        .sourceFiles = VL_GetDaStrSlice("../src/app.c"),
-        .outputPath = "app",
-        .includePaths = VL_GetDaStrSlice("../include"),
-        .extraCompilerFlags = VL_GetDaStrSlice("-DSHADER_DIRECTORY=\"../shaders/\""),
+vl_compile_ctx app_ctx = {
+    .type = Compile_DynamicLibrary,
+    .debug = false,
+    .gcSections = true,
+    .warnings = true,
+    .sourceFiles = VL_GetDaStrSlice("../src/app.c"),
+    .outputPath = "app",
+    .includePaths = VL_GetDaStrSlice("../include"),
+    .extraCompilerFlags = VL_GetDaStrSlice("-DSHADER_DIRECTORY=\"../shaders/\""),
 #if defined(_WIN32)
-        .libPaths = VL_GetDaStrSlice("../lib"),
+    .libPaths = VL_GetDaStrSlice("../lib"),
 #endif
-        .libs = VL_GetDaStrSlice("SDL3", "SDL3_ttf", "SDL3_image", "SDL3_shadercross"),
-    };
+    .libs = VL_GetDaStrSlice("SDL3", "SDL3_ttf", "SDL3_image", "SDL3_shadercross" THREAD_LIBS),
+    // Parsing the SDL headers is most of the time it takes to hot reload app.c
+    .precompiledHeader = "../include/SDL3/SDL.h",
+};
 
-    VL_SetupCCompile(cmd, &ctx);
+bool SetupAppCompile(vl_cmd *cmd, bool warningsAsErrors)
+{
+    app_ctx.warningsAsErrors = warningsAsErrors;
+    if(!VL_PrecompileHeader(&app_ctx)) return false;
+    VL_SetupCCompile(cmd, &app_ctx);
 #if defined(_MSC_VER)
     CmdAppend(cmd, "/subsystem:console");
 #endif
+    return true;
+}
 
+bool RunAppCompile(vl_cmd *cmd)
+{
 #if defined(_MSC_VER)
 # define LOCK_FILE_NAME "lock.tmp"
     char pdb_lock_str[] = "PDBSHIT";
@@ -121,6 +132,11 @@ bool CompileApp(vl_cmd *cmd, bool warningsAsErrors)
     return true;
 }
 
+bool CompileApp(vl_cmd *cmd, bool warningsAsErrors)
+{
+    return SetupAppCompile(cmd, warningsAsErrors) && RunAppCompile(cmd);
+}
+
 // NOTE: For glslc
 char *GetShaderstageFromExt(view file) {
     if(ViewEndsWith(file, VIEW_STATIC(".vert"))) {
@@ -132,20 +148,25 @@ char *GetShaderstageFromExt(view file) {
     } else return 0; // SDL_gpu doesn't support others If I understand correctly
 }
 
-bool CompileGlslShader(vl_cmd *cmd, view shaderfile)
+// Starts compiling the shader if it or any file it #includes changed, procs can be NULL to wait for it
+bool CompileGlslShader(vl_cmd *cmd, view shaderfile, vl_procs *procs)
 {
     // NOTE: To compile glsl shaders, glslc is required
     view noGlslExt = ViewFromParts(shaderfile.items, shaderfile.count - strlen(".glsl"));
     char *output = temp_sprintf(VIEW_FMT".spv", VIEW_ARG(noGlslExt));
-    if(VL_NeedsRebuild(output, shaderfile.items) == 1) {
+    // glslc -MD writes the #included files here when compiling
+    char *depfile = temp_sprintf("%s.d", output);
+    int needsRebuild = VL_NeedsRebuildDepfile(output, shaderfile.items, depfile);
+    if(needsRebuild < 0) return false;
+    if(needsRebuild == 1) {
         char *shaderStage = GetShaderstageFromExt(noGlslExt);
         if(!shaderStage) {
             VL_Log(VL_ERROR, "Invalid extension in shader file referencing shader stage '"VIEW_FMT"'", VIEW_ARG(shaderfile));
             return false;
         }
-        CmdAppend(cmd, "glslc", "-o", output, 
+        CmdAppend(cmd, "glslc", "-MD", "-MF", depfile, "-o", output,
             temp_sprintf("-fshader-stage=%s", shaderStage), shaderfile.items);
-        if(!CmdRun(cmd)) {
+        if(!CmdRun(cmd, .async = procs, .captureOutput = procs != NULL)) {
             VL_Log(VL_ERROR, "Could not compile "VIEW_FMT" to %s", VIEW_ARG(noGlslExt), output);
             return false;
         }
@@ -153,21 +174,109 @@ bool CompileGlslShader(vl_cmd *cmd, view shaderfile)
     return true;
 }
 
-void CompileGlslShadersInDirectory(vl_cmd *cmd, const char *directory)
+// Compiles the stale shaders in parallel
+bool CompileGlslShadersInDirectory(vl_cmd *cmd, const char *directory)
+{
+    bool ok = true;
+    vl_procs procs = {0};
+    vl_walk_dir walk;
+    vl_walk_entry entry;
+    if(VL_WalkDir(&walk, directory, .ext = ".glsl", .filesOnly = true)) {
+        while(VL_WalkDirNext(&walk, &entry)) {
+            view shaderfile = ViewFromCstr(entry.path);
+            // NOTE: files without a shader stage are only #included by the others
+            if(!GetShaderstageFromExt(ViewFromParts(shaderfile.items, shaderfile.count - strlen(".glsl")))) continue;
+            if(!CompileGlslShader(cmd, shaderfile, &procs)) ok = false;
+        }
+        VL_WalkDirEnd(&walk);
+    }
+    if(!VL_ProcsFlush(&procs)) ok = false;
+    DaFree(procs);
+    return ok;
+}
+
+// Copies the shader sources and the compiled shaders to dst if they changed, in a single pass over src
+void CopyShaders(const char *src, const char *dst)
 {
-    vl_file_paths files = {0};
-    if(VL_ReadEntireDir(directory, &files)) {
-        for(size_t fileIdx = 0; fileIdx < files.count; fileIdx++) {
-            const char *file = temp_sprintf("%s/%s", directory, files.items[fileIdx]);
-            view fileView = ViewFromCstr(file);
-            if(VL_GetFileType(file) == VL_FILE_REGULAR && 
-               ViewEndsWith(fileView, VIEW_STATIC(".glsl")))
+    MkdirIfNotExist(dst);
+    size_t srcLen = strlen(src);
+    vl_walk_dir walk;
+    vl_walk_entry entry;
+    if(VL_WalkDir(&walk, src)) {
+        while(VL_WalkDirNext(&walk, &entry)) {
+            const char *dstPath = temp_sprintf("%s%s", dst, entry.path + srcLen);
+            if(entry.type == VL_FILE_DIRECTORY) {
+                MkdirIfNotExist(dstPath);
+                continue;
+            }
+            view name = ViewFromCstr(entry.name);
+            if(!ViewEndsWith(name, VIEW_STATIC(".hlsl")) && !ViewEndsWith(name, VIEW_STATIC(".glsl")) &&
+               !ViewEndsWith(name, VIEW_STATIC(".spv")))
             {
-                CompileGlslShader(cmd, fileView);
+                continue;
+            }
+            if(VL_NeedsRebuild(dstPath, entry.path) == 1) VL_CopyFile(entry.path, dstPath);
+        }
+        VL_WalkDirEnd(&walk);
+    }
+}
+
+#define WATCH_SLEEP_MS 10
+
+// Stays running and recompiles app as soon as app.c or a file it #includes changes, and the glsl shaders in ../shaders.
+// The compile command (and checking the precompiled header) is only set up once.
+// Returns when program exits, or never if there's no program to wait for
+bool WatchSources(vl_cmd *cmd, vl_procs program, bool warningsAsErrors)
+{
+    vl_cmd appCmd = {0};
+    if(!SetupAppCompile(&appCmd, warningsAsErrors)) return false;
+
+    vl_file_watch watch;
+    if(!VL_WatchInit(&watch)) {
+        VL_Log(VL_ERROR, "Could not start watching ../src and ../shaders");
+        DaFree(appCmd);
+        return false;
+    }
+
+    // NOTE: files added after this aren't watched, rerun `build watch` for those
+    u64 srcBits = VL_WatchDirectory(&watch, "../src", NULL);
+    u64 shaderBits = VL_WatchDirectory(&watch, "../shaders", ".glsl");
+    // NOTE: Scans what app.c #includes now so the first change doesn't have to
+    VL_Needs_C_Rebuild(cmd, &app_ctx);
+    VL_Log(VL_INFO, "Watching ../src and ../shaders for changes");
+
+    for(;;) {
+        size_t mark = temp_save();
+        if(VL_WatchChanges(&watch, srcBits)) {
+            // NOTE: The filetimes are cached, they have to be read again. The dependency cache says if the
+            // files that changed are part of app, the others (like main_hot_reload.c) need a rerun of build
+            VL_ForgetFileTimes();
+            if(VL_Needs_C_Rebuild(cmd, &app_ctx) != 0) {
+                u64 start = VL_GetNanos();
+                DaAppendMany(cmd, appCmd.items, appCmd.count);
+                if(RunAppCompile(cmd)) {
+                    VL_Log(VL_INFO, "Recompiled app in %.2fs", (double)(VL_GetNanos() - start)/VL_NANOS_PER_SEC);
+                }
+            } else {
+                VL_Log(VL_INFO, "app is up to date, rerun build for changes outside of it");
             }
         }
+
+        // The app watches bin/shaders, so the changes have to be copied there for it to reload them.
+        // Only the shaders that are stale get compiled, including the ones #including the changed file
+        if(VL_WatchChanges(&watch, shaderBits)) {
+            CompileGlslShadersInDirectory(cmd, "../shaders");
+            CopyShaders("../shaders", "shaders");
+        }
+        temp_rewind(mark);
+
+        // Doubles as the sleep between checks
+        if(VL_WatchSleep(program, WATCH_SLEEP_MS)) break;
     }
-    VL_FREE(files.items);
+
+    VL_WatchEnd(&watch);
+    DaFree(appCmd);
+    return true;
 }
 
 int main(int argc, char **argv)
@@ -179,6 +288,7 @@ int main(int argc, char **argv)
     bool hotreload = true;
     bool shouldrun = true;
     bool warningsAsErrors = false;
+    bool watch = false;
 
     while(argc > 1) {
         char *arg = argv[--argc];
@@ -191,36 +301,46 @@ int main(int argc, char **argv)
         } else if(!strcmp(arg, "test")) {
             shouldrun = false;
             warningsAsErrors = true;
+        } else if(!strcmp(arg, "watch")) {
+            watch = true;
         }
     }
+    if(watch && !hotreload) {
+        VL_Log(VL_ERROR, "watch needs hotreload, app can't be reloaded otherwise");
+        return 1;
+    }
 
-    VL_CopyDirectoryRecursively("dependencies", "bin");
+    VL_CopyDirectoryRecursively("dependencies", "bin", .sync = true);
     VL_Pushd("bin");
-    VL_CopyDirectoryRecursively("../resources", "resources");
+    VL_CopyDirectoryRecursively("../resources", "resources", .sync = true);
 
     vl_cmd cmd = {0};
     if(!CompileApp(&cmd, warningsAsErrors)) return 1;
 
-    CompileGlslShadersInDirectory(&cmd, "../shaders");
-    VL_CopyDirectoryRecursively("../shaders", .dst = "shaders", .ext = ".hlsl");
-    VL_CopyDirectoryRecursively("../shaders", .dst = "shaders", .ext = ".glsl");
-    VL_CopyDirectoryRecursively("../shaders", .dst = "shaders", .ext = ".spv");
+    if(!CompileGlslShadersInDirectory(&cmd, "../shaders")) return 1;
+    CopyShaders("../shaders", "shaders");
 
     if(hotreload) {
         MkdirIfNotExist("hotreload");
-        // Done since we're not going to rerun the program
-        if(ProgramAlreadyRunning(EXE_NAME VL_EXE_EXTENSION)) return 0;
-
-        vl_compile_ctx ctx = {
-            .debug = false,
-            .gcSections = true,
-            .warnings = true,
-            .warningsAsErrors = warningsAsErrors,
-            .sourceFiles = VL_GetDaStrSlice("../src/main_hot_reload.c"),
-            .outputPath = EXE_NAME,
-        };
-        VL_SetupCCompile(&cmd, &ctx);
-        if(!CmdRun(&cmd)) return 1;
+        if(ProgramAlreadyRunning(EXE_NAME VL_EXE_EXTENSION)) {
+            // Done since we're not going to rerun the program
+            if(!watch) return 0;
+            shouldrun = false;
+        } else {
+            vl_compile_ctx ctx = {
+                .debug = false,
+                .gcSections = true,
+                .warnings = true,
+                .warningsAsErrors = warningsAsErrors,
+                .sourceFiles = VL_GetDaStrSlice("../src/main_hot_reload.c"),
+                .outputPath = EXE_NAME,
+#if !defined(_WIN32)
+                .libs = VL_GetDaStrSlice("pthread"),
+#endif
+            };
+            VL_SetupCCompile(&cmd, &ctx);
+            if(!CmdRun(&cmd)) return 1;
+        }
     } else {
         vl_compile_ctx ctx = {
             .debug = false,
@@ -234,12 +354,27 @@ int main(int argc, char **argv)
 #if defined(_WIN32)
             .libPaths = VL_GetDaStrSlice("../lib"),
 #endif
-            .libs = VL_GetDaStrSlice("SDL3", "SDL3_ttf", "SDL3_image", "SDL3_shadercross"),
+            .libs = VL_GetDaStrSlice("SDL3", "SDL3_ttf", "SDL3_image", "SDL3_shadercross" THREAD_LIBS),
         };
         VL_SetupCCompile(&cmd, &ctx);
         if(!CmdRun(&cmd)) return 1;
     }
 
+    if(watch) {
+        vl_procs program = {0};
+        if(shouldrun) {
+            CmdAppend(&cmd, "./" EXE_NAME);
+            if(!CmdRun(&cmd, .async = &program)) {
+                VL_Popd();
+                return 1;
+            }
+        }
+        bool ok = WatchSources(&cmd, program, warningsAsErrors);
+        DaFree(program);
+        VL_Popd();
+        return ok ? 0 : 1;
+    }
+
     if(shouldrun) {
         CmdAppend(&cmd, "./" EXE_NAME);
         if(!CmdRun(&cmd)) {
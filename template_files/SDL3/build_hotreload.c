@@ -6,6 +6,13 @@
 # define OUT_DIRECTORY "bin"
 #endif
 
+// VL_WatchInit runs the file watch on a thread, glibc older than 2.34 needs pthread linked for it
+#if defined(_WIN32)
+# define THREAD_LIBS
+#else
+# define THREAD_LIBS , "pthread"
+#endif
+
 #if defined(_WIN32)
 #include <tlhelp32.h>
 bool ProgramAlreadyRunning(const char *program)
@@ -47,7 +54,7 @@ bool ProgramAlreadyRunning(const char *program)
 
     if(!(dir = opendir("/proc"))) {
         perror("can't open /proc");
-        return -1;
+        return false;
     }
 
     while((ent = readdir(dir)) != NULL) {
@@ -60,22 +67,19 @@ bool ProgramAlreadyRunning(const char *program)
 
         /* try to open the cmdline file */
         size_t mark = temp_save();
-        char *buf = temp_sprintf("/proc/%ld/cmdline", lpid);
-        FILE* fp = fopen(buf, "r");
+        FILE* fp = fopen(temp_sprintf("/proc/%ld/cmdline", lpid), "r");
         temp_rewind(mark);
 
         if(fp) {
-            if(fgets(buf, strlen(buf), fp) != NULL) {
-                /* check the first token in the file, the program name */
-                char *first = strtok(buf, " ");
-                if(!strcmp(first, name)) {
-                    fclose(fp);
-                    closedir(dir);
+            /* the arguments are separated by '\0', so buf is argv[0] */
+            if(fgets(buf, sizeof(buf), fp) != NULL) {
+                if(!strcmp(VL_PathName(buf), program)) {
                     running = true;
                 }
             }
             fclose(fp);
         }
+        if(running) break;
     }
 
     closedir(dir);
@@ -88,23 +92,29 @@ vl_compile_ctx app_ctx = {
     .debug = false,
     .gcSections = true,
     .warnings = true,
+    .sourceFiles = VL_GetDaStrSlice("../src/app.c"),
+    .outputPath = "app",
     .includePaths = VL_GetDaStrSlice("../include"),
 #if defined(_WIN32)
     .libPaths = VL_GetDaStrSlice("../lib"),
 #endif
-    .libs = VL_GetDaStrSlice("SDL3", "SDL3_ttf", "SDL3_image"),
+    .libs = VL_GetDaStrSlice("SDL3", "SDL3_ttf", "SDL3_image" THREAD_LIBS),
+    // Parsing the SDL headers is most of the time it takes to hot reload app.c
+    .precompiledHeader = "../include/SDL3/SDL.h",
 };
 
-bool CompileApp(vl_cmd *cmd)
+bool SetupAppCompile(vl_cmd *cmd)
 {
-    app_ctx.type = Compile_DynamicLibrary;
-    app_ctx.sourceFiles = (vl_file_paths)VL_GetDaStrSlice("../src/app.c");
-    app_ctx.outputPath = "app";
+    if(!VL_PrecompileHeader(&app_ctx)) return false;
     VL_SetupCCompile(cmd, &app_ctx);
 #if defined(_MSC_VER)
     CmdAppend(cmd, "/subsystem:console");
 #endif
+    return true;
+}
 
+bool RunAppCompile(vl_cmd *cmd)
+{
 #if defined(_MSC_VER)
 # define LOCK_FILE_NAME "lock.tmp"
     char pdb_lock_str[] = "PDBSHIT";
@@ -120,6 +130,61 @@ bool CompileApp(vl_cmd *cmd)
     return true;
 }
 
+bool CompileApp(vl_cmd *cmd)
+{
+    return SetupAppCompile(cmd) && RunAppCompile(cmd);
+}
+
+#define WATCH_SLEEP_MS 10
+
+// Stays running and recompiles app as soon as app.c or a file it #includes changes.
+// The compile command (and checking the precompiled header) is only set up once.
+// Returns when program exits, or never if there's no program to wait for
+bool WatchSources(vl_cmd *cmd, vl_procs program)
+{
+    vl_cmd appCmd = {0};
+    if(!SetupAppCompile(&appCmd)) return false;
+
+    vl_file_watch watch;
+    if(!VL_WatchInit(&watch)) {
+        VL_Log(VL_ERROR, "Could not start watching ../src");
+        DaFree(appCmd);
+        return false;
+    }
+
+    // NOTE: files added to ../src after this aren't watched, rerun `build watch` for those
+    u64 srcBits = VL_WatchDirectory(&watch, "../src", NULL);
+    // NOTE: Scans what app.c #includes now so the first change doesn't have to
+    VL_Needs_C_Rebuild(cmd, &app_ctx);
+    VL_Log(VL_INFO, "Watching ../src for changes");
+
+    for(;;) {
+        if(VL_WatchChanges(&watch, srcBits)) {
+            size_t mark = temp_save();
+            // NOTE: The filetimes are cached, they have to be read again. The dependency cache says if the
+            // files that changed are part of app, the others (like main_hot_reload.c) need a rerun of build
+            VL_ForgetFileTimes();
+            if(VL_Needs_C_Rebuild(cmd, &app_ctx) != 0) {
+                u64 start = VL_GetNanos();
+                DaAppendMany(cmd, appCmd.items, appCmd.count);
+                if(RunAppCompile(cmd)) {
+                    VL_Log(VL_INFO, "Recompiled app in %.2fs", (double)(VL_GetNanos() - start)/VL_NANOS_PER_SEC);
+                }
+            } else {
+                VL_Log(VL_INFO, "app is up to date, rerun build for changes outside of it");
+            }
+            temp_rewind(mark);
+        }
+
+        // Doubles as the sleep between checks
+        if(VL_WatchSleep(program, WATCH_SLEEP_MS)) break;
+    }
+
+    VL_WatchEnd(&watch);
+    DaFree(appCmd);
+    return true;
+}
+
 int main(int argc, char **argv)
 {
     VL_GO_REBUILD_URSELF(argc, argv);
@@ -129,6 +194,7 @@ int main(int argc, char **argv)
     bool hotreload = true;
     bool shouldrun = true;
     bool warningsAsErrors = false;
+    bool watch = false;
 
     while(argc > 1) {
         char *arg = argv[--argc];
@@ -141,11 +207,17 @@ int main(int argc, char **argv)
         } else if(!strcmp(arg, "test")) {
             shouldrun = false;
             warningsAsErrors = true;
+        } else if(!strcmp(arg, "watch")) {
+            watch = true;
         }
     }
+    if(watch && !hotreload) {
+        VL_Log(VL_ERROR, "watch needs hotreload, app can't be reloaded otherwise");
+        return 1;
+    }
     app_ctx.warningsAsErrors = warningsAsErrors;
 
-    VL_CopyDirectoryRecursively("dependencies", "bin");
+    VL_CopyDirectoryRecursively("dependencies", "bin", .sync = true);
     VL_Pushd("bin");
 
     vl_cmd cmd = {0};
@@ -153,27 +225,49 @@ int main(int argc, char **argv)
 
     if(hotreload) {
         MkdirIfNotExist("hotreload");
-        // Done since we're not going to rerun the program
-        if(ProgramAlreadyRunning(EXE_NAME VL_EXE_EXTENSION)) return 0;
-
-        vl_compile_ctx ctx = {
-            .debug = false,
-            .gcSections = true,
-            .warnings = true,
-            .warningsAsErrors = warningsAsErrors,
-            .sourceFiles = VL_GetDaStrSlice("../src/main_hot_reload.c"),
-            .outputPath = EXE_NAME,
-        };
-        VL_SetupCCompile(&cmd, &ctx);
-        if(!CmdRun(&cmd)) return 1;
+        if(ProgramAlreadyRunning(EXE_NAME VL_EXE_EXTENSION)) {
+            // Done since we're not going to rerun the program
+            if(!watch) return 0;
+            shouldrun = false;
+        } else {
+            vl_compile_ctx ctx = {
+                .debug = false,
+                .gcSections = true,
+                .warnings = true,
+                .warningsAsErrors = warningsAsErrors,
+                .sourceFiles = VL_GetDaStrSlice("../src/main_hot_reload.c"),
+                .outputPath = EXE_NAME,
+#if !defined(_WIN32)
+                .libs = VL_GetDaStrSlice("pthread"),
+#endif
+            };
+            VL_SetupCCompile(&cmd, &ctx);
+            if(!CmdRun(&cmd)) return 1;
+        }
     } else {
         app_ctx.type = Compile_Executable;
         app_ctx.outputPath = EXE_NAME;
         app_ctx.sourceFiles = (vl_file_paths)VL_GetDaStrSlice("../src/main_no_hot_reload.c");
+        if(!VL_PrecompileHeader(&app_ctx)) return 1;
         VL_SetupCCompile(&cmd, &app_ctx);
         if(!CmdRun(&cmd)) return 1;
     }
 
+    if(watch) {
+        vl_procs program = {0};
+        if(shouldrun) {
+            CmdAppend(&cmd, "./" EXE_NAME);
+            if(!CmdRun(&cmd, .async = &program)) {
+                VL_Popd();
+                return 1;
+            }
+        }
+        bool ok = WatchSources(&cmd, program);
+        DaFree(program);
+        VL_Popd();
+        return ok ? 0 : 1;
+    }
+
     if(shouldrun) {
         CmdAppend(&cmd, "./" EXE_NAME);
         if(!CmdRun(&cmd)) {
@@ -16,37 +16,379 @@ const char *GetTargetFPSCauseString(int cause)
 //////////////////////////////////////////////////////////
 // work queue stuff
 
-void AddWorkEntry(WorkQueue *queue, ThreadWorkCallback callback, void *data)
+#if (WORK_QUEUE_SIZE & (WORK_QUEUE_SIZE - 1)) != 0
+#error WORK_QUEUE_SIZE must be a power of 2
+#endif
+
+// NOTE: Bounded multi-producer/multi-consumer ring, each slot has a sequence number that says
+// whose turn it is, so producers only race on enqueuePos and consumers only on dequeuePos.
+// Positions are Uint32 and wrap, the differences are compared as signed to handle that.
+static bool PushWorkRing(WorkQueue *queue, WorkQueueEntry entry)
+{
+    WorkQueueSlot *slot;
+    Uint32 pos = SDL_GetAtomicU32(&queue->enqueuePos);
+    for(;;) {
+        slot = &queue->slots[pos & (WORK_QUEUE_SIZE - 1)];
+        Sint32 diff = (Sint32)(SDL_GetAtomicU32(&slot->sequence) - pos);
+        if(diff == 0) {
+            if(SDL_CompareAndSwapAtomicU32(&queue->enqueuePos, pos, pos + 1)) break;
+            pos = SDL_GetAtomicU32(&queue->enqueuePos);
+        } else if(diff < 0) {
+            // NOTE: The slot from the previous lap hasn't been read yet, so it's full
+            return false;
+        } else {
+            pos = SDL_GetAtomicU32(&queue->enqueuePos);
+        }
+    }
+
+    slot->entry = entry;
+    SDL_SetAtomicU32(&slot->sequence, pos + 1);
+    return true;
+}
+
+static bool PopWorkRing(WorkQueue *queue, WorkQueueEntry *entry)
+{
+    WorkQueueSlot *slot;
+    Uint32 pos = SDL_GetAtomicU32(&queue->dequeuePos);
+    for(;;) {
+        slot = &queue->slots[pos & (WORK_QUEUE_SIZE - 1)];
+        Sint32 diff = (Sint32)(SDL_GetAtomicU32(&slot->sequence) - (pos + 1));
+        if(diff == 0) {
+            if(SDL_CompareAndSwapAtomicU32(&queue->dequeuePos, pos, pos + 1)) break;
+            pos = SDL_GetAtomicU32(&queue->dequeuePos);
+        } else if(diff < 0) {
+            // NOTE: Nothing has been written here yet, so it's empty
+            return false;
+        } else {
+            pos = SDL_GetAtomicU32(&queue->dequeuePos);
+        }
+    }
+
+    *entry = slot->entry;
+    SDL_SetAtomicU32(&slot->sequence, pos + WORK_QUEUE_SIZE);
+    return true;
+}
+
+#if defined(WORK_QUEUE_WORK_STEALING)
+#if (WORK_DEQUE_SIZE & (WORK_DEQUE_SIZE - 1)) != 0
+#error WORK_DEQUE_SIZE must be a power of 2
+#endif
+
+// NOTE: SDL atomics are sequentially consistent, which is what the original Chase-Lev paper assumes
+static bool PushWorkDeque(WorkDeque *deque, WorkQueueEntry entry)
+{
+    Uint32 bottom = SDL_GetAtomicU32(&deque->bottom);
+    Uint32 top = SDL_GetAtomicU32(&deque->top);
+    if((Sint32)(bottom - top) >= WORK_DEQUE_SIZE) return false;
+
+    deque->entries[bottom & (WORK_DEQUE_SIZE - 1)] = entry;
+    SDL_SetAtomicU32(&deque->bottom, bottom + 1);
+    return true;
+}
+
+static bool PopWorkDeque(WorkDeque *deque, WorkQueueEntry *entry)
+{
+    // NOTE: Claim the bottom entry first so thieves see it's taken before we look at top
+    Uint32 bottom = SDL_GetAtomicU32(&deque->bottom) - 1;
+    SDL_SetAtomicU32(&deque->bottom, bottom);
+    Uint32 top = SDL_GetAtomicU32(&deque->top);
+
+    Sint32 size = (Sint32)(bottom - top);
+    if(size < 0) {
+        SDL_SetAtomicU32(&deque->bottom, top);
+        return false;
+    }
+
+    *entry = deque->entries[bottom & (WORK_DEQUE_SIZE - 1)];
+    if(size > 0) return true;
+
+    // NOTE: Last entry, thieves could be going for it too
+    bool won = SDL_CompareAndSwapAtomicU32(&deque->top, top, top + 1);
+    SDL_SetAtomicU32(&deque->bottom, top + 1);
+    return won;
+}
+
+static bool StealWorkDeque(WorkDeque *deque, WorkQueueEntry *entry)
+{
+    Uint32 top = SDL_GetAtomicU32(&deque->top);
+    Uint32 bottom = SDL_GetAtomicU32(&deque->bottom);
+    if((Sint32)(bottom - top) <= 0) return false;
+
+    *entry = deque->entries[top & (WORK_DEQUE_SIZE - 1)];
+    return SDL_CompareAndSwapAtomicU32(&deque->top, top, top + 1);
+}
+#endif
+
+static Uint32 GetWorkerIndex(WorkQueue *queue)
+{
+    return (Uint32)(uintptr_t)SDL_GetTLS(&queue->workerIndex);
+}
+
+static bool TryPushWorkEntry(WorkQueue *queue, WorkQueueEntry entry)
 {
-    Uint32 nextEntryToWrite = (queue->nextEntryToWrite + 1) % SDL_arraysize(queue->entries);
-    // TODO: If this is the case, the work queue should be larger/resizable
-    SDL_assert((int)nextEntryToWrite != SDL_GetAtomicInt(&queue->nextEntryToRead));
-    WorkQueueEntry *entry = &queue->entries[queue->nextEntryToWrite];
-    entry->callback = callback;
-    entry->data = data;
+    // NOTE: Before publishing, otherwise CompleteAllWorkerEntries could see goal == count while this runs
     SDL_AddAtomicInt(&queue->completionGoal, 1);
-    SDL_CompilerBarrier();
-    queue->nextEntryToWrite = nextEntryToWrite;
-    SDL_SignalSemaphore(queue->semaphore);
+    bool added = false;
+#if defined(WORK_QUEUE_WORK_STEALING)
+    Uint32 workerIndex = GetWorkerIndex(queue);
+    if(workerIndex) added = PushWorkDeque(&queue->deques[workerIndex - 1], entry);
+#endif
+    if(!added) added = PushWorkRing(queue, entry);
+
+    if(added) SDL_SignalSemaphore(queue->semaphore);
+    else SDL_AddAtomicInt(&queue->completionGoal, -1);
+    return added;
+}
+
+bool TryAddWorkEntry(WorkQueue *queue, ThreadWorkCallback callback, void *data)
+{
+    WorkQueueEntry entry = {callback, data, NULL};
+    return TryPushWorkEntry(queue, entry);
+}
+
+static bool GetNextWorkEntry(WorkQueue *queue, WorkQueueEntry *entry)
+{
+#if defined(WORK_QUEUE_WORK_STEALING)
+    Uint32 workerIndex = GetWorkerIndex(queue);
+    if(workerIndex && PopWorkDeque(&queue->deques[workerIndex - 1], entry)) return true;
+    if(PopWorkRing(queue, entry)) return true;
+
+    // NOTE: Start at a random victim so the thieves don't all pile onto the same deque
+    Uint32 start = 0;
+    if(workerIndex) {
+        Uint32 *state = &queue->deques[workerIndex - 1].randomState;
+        *state ^= *state << 13;
+        *state ^= *state >> 17;
+        *state ^= *state << 5;
+        start = *state;
+    }
+    for(Uint32 i = 0; i < queue->threadCount; i++) {
+        Uint32 victim = (start + i) % queue->threadCount;
+        if(victim + 1 == workerIndex) continue;
+        if(StealWorkDeque(&queue->deques[victim], entry)) return true;
+    }
+    return false;
+#else
+    return PopWorkRing(queue, entry);
+#endif
+}
+
+static void FinishWorkGroupEntry(WorkQueue *queue, WorkGroup *group);
+
+static void RunWorkEntry(SpallProfile *spall_ctx, SpallBuffer *spall_buffer, WorkQueue *queue, WorkQueueEntry entry)
+{
+    entry.callback(spall_ctx, spall_buffer, entry.data);
+    // NOTE: Before completionCount so the dependents are counted in completionGoal first
+    if(entry.group) FinishWorkGroupEntry(queue, entry.group);
+    SDL_AddAtomicInt(&queue->completionCount, 1);
 }
 
 static bool DoNextWorkEntry(SpallProfile *spall_ctx, SpallBuffer *spall_buffer, WorkQueue *queue)
 {
-    bool shouldSleep = false;
+    WorkQueueEntry entry;
+    if(!GetNextWorkEntry(queue, &entry)) return true;
+
+    RunWorkEntry(spall_ctx, spall_buffer, queue, entry);
+    return false;
+}
 
-    Uint32 originalNextEntryToRead = SDL_GetAtomicInt(&queue->nextEntryToRead);
-    Uint32 nextEntryToRead = (originalNextEntryToRead + 1) % SDL_arraysize(queue->entries);
-    if(originalNextEntryToRead != queue->nextEntryToWrite) {
-        if(SDL_CompareAndSwapAtomicInt(&queue->nextEntryToRead, originalNextEntryToRead, nextEntryToRead)) {
-            WorkQueueEntry *entry = &queue->entries[originalNextEntryToRead];
-            entry->callback(spall_ctx, spall_buffer, entry->data);
-            SDL_AddAtomicInt(&queue->completionCount, 1);
+static void PushWorkEntry(WorkQueue *queue, WorkQueueEntry entry)
+{
+    while(!TryPushWorkEntry(queue, entry)) {
+        // NOTE: Only workers can help drain it, the callbacks need the thread's spall buffer
+        Uint32 workerIndex = GetWorkerIndex(queue);
+        if(workerIndex) {
+            DoNextWorkEntry(queue->spall_ctx, &queue->spall_buffers[workerIndex - 1], queue);
+        } else {
+            SDL_Delay(0);
         }
+    }
+}
+
+void AddWorkEntry(WorkQueue *queue, ThreadWorkCallback callback, void *data)
+{
+    WorkQueueEntry entry = {callback, data, NULL};
+    PushWorkEntry(queue, entry);
+}
+
+static void FinishWorkGroupEntry(WorkQueue *queue, WorkGroup *group)
+{
+    // NOTE: The decrement happens under the lock so WorkGroupDone can make sure we're
+    // not touching the group anymore before saying it's done (it could be on the stack)
+    WorkQueueEntry dependents[WORK_GROUP_MAX_DEPENDENTS];
+    Uint32 dependentCount = 0;
+    SDL_LockSpinlock(&group->lock);
+    if(SDL_AddAtomicInt(&group->pending, -1) == 1) {
+        dependentCount = group->dependentCount;
+        SDL_memcpy(dependents, group->dependents, dependentCount*sizeof(WorkQueueEntry));
+        group->dependentCount = 0;
+    }
+    SDL_UnlockSpinlock(&group->lock);
+
+    for(Uint32 dependentIdx = 0; dependentIdx < dependentCount; dependentIdx++) {
+        PushWorkEntry(queue, dependents[dependentIdx]);
+    }
+}
+
+void WorkGroupBegin(WorkGroup *group)
+{
+    SDL_zerop(group);
+}
+
+void AddWorkEntryToGroup(WorkQueue *queue, WorkGroup *group, ThreadWorkCallback callback, void *data)
+{
+    if(group) SDL_AddAtomicInt(&group->pending, 1);
+    WorkQueueEntry entry = {callback, data, group};
+    PushWorkEntry(queue, entry);
+}
+
+bool AddWorkEntryAfterGroup(WorkQueue *queue, WorkGroup *after, WorkGroup *group, ThreadWorkCallback callback, void *data)
+{
+    WorkQueueEntry entry = {callback, data, group};
+    bool addNow = false;
+    SDL_LockSpinlock(&after->lock);
+    if(SDL_GetAtomicInt(&after->pending) == 0) {
+        addNow = true;
+    } else if(after->dependentCount < WORK_GROUP_MAX_DEPENDENTS) {
+        // NOTE: Counted now so waiting on group also waits for this while it's held back
+        if(group) SDL_AddAtomicInt(&group->pending, 1);
+        after->dependents[after->dependentCount++] = entry;
     } else {
-        shouldSleep = true;
+        SDL_UnlockSpinlock(&after->lock);
+        return false;
+    }
+    SDL_UnlockSpinlock(&after->lock);
+
+    if(addNow) AddWorkEntryToGroup(queue, group, callback, data);
+    return true;
+}
+
+bool WorkGroupDone(WorkGroup *group)
+{
+    if(SDL_GetAtomicInt(&group->pending) != 0) return false;
+    // NOTE: Wait for whoever finished the last entry to let go of the group
+    SDL_LockSpinlock(&group->lock);
+    SDL_UnlockSpinlock(&group->lock);
+    return true;
+}
+
+#if defined(WORK_QUEUE_WORK_STEALING)
+static bool WorkDequesEmpty(WorkQueue *queue)
+{
+    for(Uint32 workerIdx = 0; workerIdx < queue->threadCount; workerIdx++) {
+        WorkDeque *deque = &queue->deques[workerIdx];
+        if((Sint32)(SDL_GetAtomicU32(&deque->bottom) - SDL_GetAtomicU32(&deque->top)) > 0) return false;
+    }
+    return true;
+}
+#endif
+
+void WorkGroupWait(SpallProfile *spall_ctx, SpallBuffer *spall_buffer, WorkQueue *queue, WorkGroup *group)
+{
+    // NOTE: Entries from other groups are put back so waiting on a small batch doesn't get stuck running
+    // something long like a shader recompile. Everything from lapStart on was put back by us, so once the
+    // ring has nothing else left we back off instead of cycling them (and waking up workers) forever
+    bool requeued = false;
+    Uint32 lapStart = 0;
+    Uint32 requeuedCount = 0;
+    while(!WorkGroupDone(group)) {
+        if(requeued) {
+            Uint32 enqueuePos = SDL_GetAtomicU32(&queue->enqueuePos);
+            if(enqueuePos - lapStart != requeuedCount) {
+                // NOTE: Someone else added work, go around again
+                requeued = false;
+            } else if((Sint32)(SDL_GetAtomicU32(&queue->dequeuePos) - lapStart) >= 0
+#if defined(WORK_QUEUE_WORK_STEALING)
+                      && WorkDequesEmpty(queue)
+#endif
+                      ) {
+                SDL_Delay(0);
+                continue;
+            }
+        }
+
+        WorkQueueEntry entry;
+        if(!GetNextWorkEntry(queue, &entry)) {
+            SDL_CPUPauseInstruction();
+        } else if(entry.group == group) {
+            RunWorkEntry(spall_ctx, spall_buffer, queue, entry);
+        } else {
+            if(!requeued) {
+                requeued = true;
+                lapStart = SDL_GetAtomicU32(&queue->enqueuePos);
+                requeuedCount = 0;
+            }
+            // NOTE: Already counted in completionGoal, only needs waking someone up again
+            if(PushWorkRing(queue, entry)) {
+                requeuedCount++;
+                SDL_SignalSemaphore(queue->semaphore);
+            } else {
+                RunWorkEntry(spall_ctx, spall_buffer, queue, entry);
+            }
+        }
+    }
+}
+
+typedef struct {
+    ParallelForCallback callback;
+    void *data;
+    Uint32 count;
+    Uint32 minChunk;
+    Uint32 participants;
+    SDL_AtomicU32 next; // First element that hasn't been handed out yet
+} ParallelForRange;
+
+static void RunParallelForChunks(SpallProfile *spall_ctx, SpallBuffer *spall_buffer, ParallelForRange *range)
+{
+    for(;;) {
+        Uint32 start = SDL_GetAtomicU32(&range->next);
+        if(start >= range->count) break;
+
+        // NOTE: Guided scheduling, a share of what's left so the first chunks are big and the last ones
+        // are small enough that nobody is left running a big chunk while everyone else is done
+        Uint32 remaining = range->count - start;
+        Uint32 chunk = remaining/(2*range->participants);
+        if(chunk < range->minChunk) chunk = range->minChunk;
+        if(chunk > remaining) chunk = remaining;
+
+        if(SDL_CompareAndSwapAtomicU32(&range->next, start, start + chunk)) {
+            range->callback(spall_ctx, spall_buffer, range->data, start, start + chunk);
+        }
     }
+}
+
+static int ParallelForWork(SpallProfile *spall_ctx, SpallBuffer *spall_buffer, void *data)
+{
+    RunParallelForChunks(spall_ctx, spall_buffer, (ParallelForRange*)data);
+    return 0;
+}
+
+void ParallelFor(SpallProfile *spall_ctx, SpallBuffer *spall_buffer, WorkQueue *queue, Uint32 count, Uint32 minChunk, ParallelForCallback callback, void *data)
+{
+    if(count == 0) return;
+    if(minChunk == 0) minChunk = 1;
+
+    ParallelForRange range = {
+        .callback = callback,
+        .data = data,
+        .count = count,
+        .minChunk = minChunk,
+        .participants = queue->threadCount + 1,
+    };
+    SDL_SetAtomicU32(&range.next, 0);
 
-    return shouldSleep;
+    // NOTE: One entry per worker that could get a chunk, the calling thread takes the first one
+    Uint32 chunkCount = count/minChunk + (count % minChunk != 0);
+    Uint32 helperCount = SDL_min(chunkCount - 1, queue->threadCount);
+
+    WorkGroup group;
+    WorkGroupBegin(&group);
+    for(Uint32 helperIdx = 0; helperIdx < helperCount; helperIdx++) {
+        AddWorkEntryToGroup(queue, &group, ParallelForWork, &range);
+    }
+    RunParallelForChunks(spall_ctx, spall_buffer, &range);
+    // NOTE: range is on the stack, the helpers must be done with it before returning
+    WorkGroupWait(spall_ctx, spall_buffer, queue, &group);
 }
 
 void CompleteAllWorkerEntries(SpallProfile *spall_ctx, SpallBuffer *spall_buffer, WorkQueue *queue)
@@ -54,9 +396,6 @@ void CompleteAllWorkerEntries(SpallProfile *spall_ctx, SpallBuffer *spall_buffer
     while(SDL_GetAtomicInt(&queue->completionGoal) != SDL_GetAtomicInt(&queue->completionCount)) {
         DoNextWorkEntry(spall_ctx, spall_buffer, queue);
     }
-
-    SDL_SetAtomicInt(&queue->completionGoal, 0);
-    SDL_SetAtomicInt(&queue->completionCount, 0);
 }
 
 static int SDLCALL ThreadProc(void *data)
@@ -65,7 +404,8 @@ static int SDLCALL ThreadProc(void *data)
     WorkQueue *queue = tdata->queue;
     int threadIdx = tdata->threadIdx;
     SDL_free(data);
-    
+
+    SDL_SetTLS(&queue->workerIndex, (void*)(uintptr_t)(threadIdx + 1), NULL);
     for(;;) {
         if(DoNextWorkEntry(queue->spall_ctx, &queue->spall_buffers[threadIdx], queue)) {
             SDL_WaitSemaphore(queue->semaphore);
@@ -84,8 +424,11 @@ bool InitWorkQueue(SpallProfile *spall_ctx, WorkQueue *queue, Uint32 threadCount
     SDL_SetAtomicInt(&queue->completionGoal, 0);
     SDL_SetAtomicInt(&queue->completionCount, 0);
 
-    queue->nextEntryToWrite = 0;
-    SDL_SetAtomicInt(&queue->nextEntryToRead, 0);
+    SDL_SetAtomicU32(&queue->enqueuePos, 0);
+    SDL_SetAtomicU32(&queue->dequeuePos, 0);
+    for(Uint32 slotIdx = 0; slotIdx < WORK_QUEUE_SIZE; slotIdx++) {
+        SDL_SetAtomicU32(&queue->slots[slotIdx].sequence, slotIdx);
+    }
 
     // TODO: Error reporting
     queue->semaphore = SDL_CreateSemaphore(0);
@@ -101,6 +444,18 @@ bool InitWorkQueue(SpallProfile *spall_ctx, WorkQueue *queue, Uint32 threadCount
     Uint8 *backingBuffer = SDL_malloc(threadCount*SPALL_BUFFER_SIZE);
     if(!backingBuffer) return false;
 
+    SDL_SetAtomicInt(&queue->workerIndex, 0);
+
+#if defined(WORK_QUEUE_WORK_STEALING)
+    queue->deques = SDL_malloc(threadCount*sizeof(WorkDeque));
+    if(!queue->deques) return false;
+    for(Uint32 threadIdx = 0; threadIdx < threadCount; threadIdx++) {
+        SDL_SetAtomicU32(&queue->deques[threadIdx].top, 0);
+        SDL_SetAtomicU32(&queue->deques[threadIdx].bottom, 0);
+        queue->deques[threadIdx].randomState = 2654435761u*(threadIdx + 1);
+    }
+#endif
+
     queue->threadCount = threadCount;
     char threadNameBuf[40];
     for(Uint32 threadIdx = 0; threadIdx < threadCount; threadIdx++) {
@@ -36,25 +36,80 @@ const char *GetTargetFPSCauseString(int cause);
 
 typedef int (*ThreadWorkCallback)(SpallProfile *spall_ctx, SpallBuffer *spall_buffer, void *data);
 
+// NOTE: Must be a power of 2
+#define WORK_QUEUE_SIZE 256
+
+typedef struct WorkGroup WorkGroup;
+
 typedef struct {
     ThreadWorkCallback callback;
     void *data;
+    WorkGroup *group; // Can be NULL
 } WorkQueueEntry;
 
+#ifndef WORK_GROUP_MAX_DEPENDENTS
+#define WORK_GROUP_MAX_DEPENDENTS 8
+#endif
+
+// NOTE: Lets you wait for a batch of work without waiting for everything else in the queue,
+// entries can also be made to depend on a group so they're only added once the group is done
+struct WorkGroup {
+    SDL_AtomicInt pending; // Entries in the group that haven't finished yet
+    SDL_SpinLock lock; // Taken when finishing an entry of the group and for the dependents
+    Uint32 dependentCount;
+    WorkQueueEntry dependents[WORK_GROUP_MAX_DEPENDENTS]; // Added to the queue when pending reaches 0
+};
+
+typedef struct {
+    // NOTE: sequence == position: free to write, sequence == position + 1: ready to read,
+    // after reading it's set to position + WORK_QUEUE_SIZE so it's free again on the next lap
+    SDL_AtomicU32 sequence;
+    WorkQueueEntry entry;
+} WorkQueueSlot;
+
+// NOTE: Define WORK_QUEUE_WORK_STEALING before including this to give every worker its own deque,
+// work added from a worker goes to its deque and idle workers steal from the others, the shared
+// ring is then only used for work added from other threads (or when a deque is full)
+#if defined(WORK_QUEUE_WORK_STEALING)
+// NOTE: Must be a power of 2
+#ifndef WORK_DEQUE_SIZE
+#define WORK_DEQUE_SIZE 256
+#endif
+
+// NOTE: Chase-Lev deque, the owning worker pushes and pops at the bottom, thieves take from the top
+typedef struct {
+    Uint8 topPad[64];
+    SDL_AtomicU32 top;
+    Uint8 bottomPad[64];
+    SDL_AtomicU32 bottom;
+    Uint32 randomState; // Only touched by the owner, picks who to steal from
+    WorkQueueEntry entries[WORK_DEQUE_SIZE];
+} WorkDeque;
+#endif
+
 typedef struct {
     SDL_AtomicInt completionGoal;
     SDL_AtomicInt completionCount;
-    volatile Uint32 nextEntryToWrite;
-    SDL_AtomicInt nextEntryToRead;
     SDL_Semaphore *semaphore;
 
-    WorkQueueEntry entries[256];
+    // NOTE: Producers and consumers each CAS on their own position, keep them on separate cache lines
+    Uint8 enqueuePad[64];
+    SDL_AtomicU32 enqueuePos;
+    Uint8 dequeuePad[64];
+    SDL_AtomicU32 dequeuePos;
+    Uint8 slotsPad[64];
+    WorkQueueSlot slots[WORK_QUEUE_SIZE];
 
     Uint32 threadCount;
     SDL_Thread **threads;
 
     SpallProfile *spall_ctx;
     SpallBuffer *spall_buffers;
+    SDL_TLSID workerIndex; // Worker index + 1 on worker threads, 0 on any other thread
+
+#if defined(WORK_QUEUE_WORK_STEALING)
+    WorkDeque *deques; // One per worker thread
+#endif
 } WorkQueue;
 
 typedef struct {
@@ -125,8 +180,26 @@ typedef struct {
 #define IsKeyPressed_Ptr(input, keycode) IsKeyDoingSomething_Ptr(input, Pressed, keycode)
 #define IsKeyReleased_Ptr(input, keycode) IsKeyDoingSomething_Ptr(input, Released, keycode)
 
+// NOTE: These can be called from any thread, including from inside a ThreadWorkCallback.
+// TryAddWorkEntry returns false when the queue is full, AddWorkEntry doesn't fail: when the queue
+// is full a worker thread runs queued work itself until there's room, other threads wait for the workers
+bool TryAddWorkEntry(WorkQueue *queue, ThreadWorkCallback callback, void *data);
 void AddWorkEntry(WorkQueue *queue, ThreadWorkCallback callback, void *data);
 void CompleteAllWorkerEntries(SpallProfile *spall_ctx, SpallBuffer *spall_buffer, WorkQueue *queue);
+
+void WorkGroupBegin(WorkGroup *group);
+void AddWorkEntryToGroup(WorkQueue *queue, WorkGroup *group, ThreadWorkCallback callback, void *data);
+// NOTE: Adds the entry (to group, which can be NULL) once every entry in after has finished,
+// returns false if after already has WORK_GROUP_MAX_DEPENDENTS dependents
+bool AddWorkEntryAfterGroup(WorkQueue *queue, WorkGroup *after, WorkGroup *group, ThreadWorkCallback callback, void *data);
+bool WorkGroupDone(WorkGroup *group);
+// NOTE: Runs the group's queued entries on the calling thread while it waits, the rest is left to the workers
+void WorkGroupWait(SpallProfile *spall_ctx, SpallBuffer *spall_buffer, WorkQueue *queue, WorkGroup *group);
+
+typedef void (*ParallelForCallback)(SpallProfile *spall_ctx, SpallBuffer *spall_buffer, void *data, Uint32 start, Uint32 end);
+// NOTE: Calls callback for chunks of [0, count) of at least minChunk elements on the workers and
+// the calling thread, chunks get smaller towards the end to balance the load. Returns once it's all done
+void ParallelFor(SpallProfile *spall_ctx, SpallBuffer *spall_buffer, WorkQueue *queue, Uint32 count, Uint32 minChunk, ParallelForCallback callback, void *data);
 bool InitWorkQueue(SpallProfile *spall_ctx, WorkQueue *queue, Uint32 threadCount);
 
 void HandleSDLKeyDownEvent(ProgramInput *input, SDL_Event *event);
@@ -56,7 +56,6 @@ bool LoadProgramApi(ProgramApi *api, int version)
         if(GetLastWriteTime(DLL_NAME, &api->modificationTime)) {
             size_t mark = temp_save();
             char *dllname = temp_sprintf(DLL_DIR "/app_%d" DLL_EXT, version);
-            temp_rewind(mark);
             CopyFile(DLL_NAME, dllname, FALSE);
 
             api->library = LoadLibraryA(dllname);
@@ -75,6 +74,7 @@ bool LoadProgramApi(ProgramApi *api, int version)
             } else {
                 printf("%s\n", Win32_ErrorMessage(GetLastError()));
             }
+            temp_rewind(mark);
         }
     }
 
@@ -105,10 +105,9 @@ bool LoadProgramApi(ProgramApi *api, int version)
     bool ok = false;
 
     if(GetLastWriteTime(DLL_NAME, &api->modificationTime)) {
-        size_t mark = nob_temp_save();
-        char *dllname = nob_temp_sprintf(DLL_DIR "/app_%d" DLL_EXT, version);
-        nob_temp_rewind(mark);
-        if(VL_CopyFile(DLL_NAME, dllname, FALSE)) {
+        size_t mark = temp_save();
+        char *dllname = temp_sprintf(DLL_DIR "/app_%d" DLL_EXT, version);
+        if(VL_CopyFile(DLL_NAME, dllname)) {
             api->library = dlopen(dllname, RTLD_NOW);
             if(api->library) {
                 api->appInit = (BoolVoidStarProc)dlsym(api->library, "AppInit");
@@ -124,6 +123,7 @@ bool LoadProgramApi(ProgramApi *api, int version)
                 if(ok) api->version = version;
             }
         }
+        temp_rewind(mark);
     }
 
     return ok;
@@ -178,14 +178,31 @@ int main(int argc, char **argv)
         return 1;
     }
 
+    // The watch thread tells us when the dll changes so the loop doesn't have to check it every frame,
+    // if it can't be started, fall back to checking the write time
+    vl_file_watch watch;
+    uint64_t dllWatchBit = 0;
+    if(VL_WatchInit(&watch)) {
+        dllWatchBit = VL_WatchFile(&watch, DLL_NAME);
+        if(!dllWatchBit) VL_WatchEnd(&watch);
+    }
+
     ProgramApis oldApis = {0};
     ProgramApi newApi = {0};
     bool quit = false;
+    bool reloadPending = false;
     while(!quit) {
-        uint64_t fileTime;
+        if(dllWatchBit) {
+            if(VL_WatchChanges(&watch, dllWatchBit)) reloadPending = true;
+        } else {
+            uint64_t fileTime;
+            reloadPending = GetLastWriteTime(DLL_NAME, &fileTime) && api.modificationTime != fileTime;
+        }
 
-        if(GetLastWriteTime(DLL_NAME, &fileTime) && api.modificationTime != fileTime) {
+        // NOTE: keeps trying until it loads, on windows the lock file is still there when the dll changes
+        if(reloadPending) {
             if(LoadProgramApi(&newApi, version)) {
+                reloadPending = false;
                 if(api.memorySize() == newApi.memorySize()) {
                     // normal hot reload
                     DaAppend(&oldApis, api);
@@ -225,6 +242,7 @@ int main(int argc, char **argv)
     free(appMemory);
 
 endProgram:
+    if(dllWatchBit) VL_WatchEnd(&watch);
     for(size_t apiIdx = 0; apiIdx < oldApis.count; apiIdx++) {
         UnloadApi(&oldApis.items[apiIdx]);
     }
@@ -12,6 +12,7 @@ Defines: To have any of these take effect, you must define them _before_ includi
  - VICLIB_NO*: If you want to remove parts of the library:
    - VICLIB_NO_TEMP_ARENA: remove ArenaTemp
    - VICLIB_NO_SORT: remove Sort and all functions used by it
+   - VICLIB_NO_FILE_WATCH: remove VL_Watch* (the only part that starts threads)
 Check VL_ErrorNumber when errors occur.
 
 --Many thanks to the inspirations for this library:
@@ -166,6 +167,7 @@ typedef HANDLE vl_fd;
 #include <fcntl.h>
 #include <unistd.h>
 #include <sys/stat.h>
+#include <sys/mman.h>
 
 typedef int vl_proc;
 # define VL_INVALID_PROC (-1)
@@ -181,6 +183,7 @@ typedef int vl_fd;
 #include <fcntl.h>
 #include <unistd.h>
 #include <sys/stat.h>
+#include <sys/mman.h>
 
 typedef int vl_proc;
 # define VL_INVALID_PROC (-1)
@@ -193,6 +196,16 @@ typedef int vl_fd;
 #else
 #error Unsupported OS
 #endif // OS
+
+#if !defined(VICLIB_NO_FILE_WATCH)
+# if OS_LINUX
+#  include <pthread.h>
+#  include <sys/inotify.h>
+# elif OS_MAC
+#  include <pthread.h>
+#  include <sys/event.h>
+# endif
+#endif
 #endif // !defined(VICLIB_NO_PLATFORM)
 
 /* DebugBreakpoint for different platforms.
@@ -748,6 +761,14 @@ VLIBPROC void *ExpArrayGet_Generic(exp_array_hdr const *xar, exp_array_meta meta
 #define ExpArrayAppend(arena, exp, item) ExpArrayAppend_Generic((arena), &(exp)->hdr, (exp)->meta, &(item))
 VLIBPROC void *ExpArrayAppend_Generic(memory_arena *arena, exp_array_hdr *xar, exp_array_meta meta, void *data);
 
+////////////////////////////////
+// Hashing
+
+/* Fast non-cryptographic 64-bit hash, made like xxh3 (but it doesn't give the same values).
+ * Uses SSE2 or NEON if available, define VL_HASH_NO_SIMD to only use the scalar version.
+ * All the versions give the same result */
+VLIBPROC u64 VL_Hash64(const void *data, size_t len, u64 seed);
+
 ////////////////////////////////
 
 #ifdef RADDBG_MARKUP_H
@@ -846,8 +867,83 @@ VLIBPROC bool ReadFileChunk(vl_file_chunk *Chunk, const char *File, u32 *ChunkSi
 VLIBPROC char *ReadEntireFile(memory_arena *Arena, char *File, size_t *Size);
 VLIBPROC bool WriteEntireFile(const char *File, const void *Data, size_t Size);
 
+typedef struct {
+    u8 *Data; // 0 for empty files
+    size_t Size;
+} vl_mapped_file;
+
+/* Maps the whole file as read only memory, the file doesn't need to stay open */
+VLIBPROC bool VL_MapFile(vl_mapped_file *Map, const char *File);
+VLIBPROC void VL_UnmapFile(vl_mapped_file *Map);
+
 #endif // !defined(VICLIB_NO_FILE_IO)
 
+#if !defined(VICLIB_NO_FILE_WATCH)
+
+#ifndef VL_WATCH_NAMES_SIZE
+#define VL_WATCH_NAMES_SIZE 4096
+#endif
+#define VL_WATCH_MAX_FILES 64 // one bit each in the change mask
+#define VL_WATCH_MAX_DIRS 16 // only on windows, each one has its own read buffer
+
+typedef struct {
+    u32 Dir;  /* offset into vl_file_watch.Names */
+    u32 Name; /* same, file name without the directory */
+#if OS_LINUX
+    int Wd;
+#elif OS_MAC
+    int DirFd;
+    int FileFd;
+#elif OS_WINDOWS
+    u32 DirIndex;
+#endif
+} vl__watched_file;
+
+#if OS_WINDOWS
+typedef struct {
+    HANDLE Handle;
+    OVERLAPPED Overlapped;
+    u32 Dir; /* offset into vl_file_watch.Names */
+    DWORD Buffer[1024];
+} vl__watched_dir;
+#endif
+
+// Watches files from a background thread (inotify, ReadDirectoryChangesW, kqueue),
+// changes get coalesced into one bit per file so checking them doesn't need any syscalls
+typedef struct {
+    u64 Pending; /* set by the watch thread, cleared by VL_WatchChanges */
+    u32 Count;
+    vl__watched_file Files[VL_WATCH_MAX_FILES];
+    u32 NamesSize;
+    char Names[VL_WATCH_NAMES_SIZE];
+#if OS_WINDOWS
+    HANDLE Thread;
+    HANDLE Wake; /* new directory to watch or VL_WatchEnd */
+    u32 DirCount;
+    vl__watched_dir Dirs[VL_WATCH_MAX_DIRS];
+    bool Stop;
+#elif OS_LINUX
+    pthread_t Thread;
+    int Fd;
+    int WakeFd[2];
+#elif OS_MAC
+    pthread_t Thread;
+    int Kq;
+#endif
+} vl_file_watch;
+
+/* Starts the watch thread, Watch must stay at the same address until VL_WatchEnd */
+VLIBPROC bool VL_WatchInit(vl_file_watch *Watch);
+/* Returns the bit VL_WatchChanges reports File with or 0 on error.
+ * Files are written or replaced by editors and compilers in many different ways,
+ * so this watches the directory File is in */
+VLIBPROC u64 VL_WatchFile(vl_file_watch *Watch, const char *File);
+/* Returns which of the files in Mask changed since the last call and clears them, doesn't do any syscalls */
+VLIBPROC u64 VL_WatchChanges(vl_file_watch *Watch, u64 Mask);
+VLIBPROC void VL_WatchEnd(vl_file_watch *Watch);
+
+#endif // !defined(VICLIB_NO_FILE_WATCH)
+
 VLIBPROC const char *VL_GetError(void);
 
 #endif // !defined(VICLIB_NO_PLATFORM)
@@ -1668,6 +1764,150 @@ VLIBPROC void *ExpArrayAppend_Generic(memory_arena *arena, exp_array_hdr *xar, e
 
 ////////////////////////////////
 
+#if !defined(VL_HASH_NO_SIMD) && ARCH_X64 && !COMPILER_TCC
+# define VL__HASH_SSE2 1
+# include <emmintrin.h>
+#elif !defined(VL_HASH_NO_SIMD) && ARCH_ARM64
+# define VL__HASH_NEON 1
+#endif
+
+#define VL__HASH_STRIPE_LEN 64
+#define VL__HASH_STRIPES_PER_BLOCK 16
+#define VL__HASH_PRIME32_1 0x9E3779B1U
+#define VL__HASH_PRIME32_2 0x85EBCA77U
+#define VL__HASH_PRIME32_3 0xC2B2AE3DU
+#define VL__HASH_PRIME64_1 0x9E3779B185EBCA87ULL
+#define VL__HASH_PRIME64_2 0xC2B2AE3D27D4EB4FULL
+#define VL__HASH_PRIME64_3 0x165667B19E3779F9ULL
+#define VL__HASH_PRIME64_4 0x85EBCA77C2B2AE63ULL
+#define VL__HASH_PRIME64_5 0x27D4EB2F165667C5ULL
+
+// splitmix64 of the digits of pi, the first 8 are the stripe keys, the last 8 the scramble keys
+static const u64 VL__hashSecret[16] = {
+    0x2CB0F69F4ABEA221ULL, 0x9417034723148989ULL, 0xDD555950609DFE03ULL, 0xDBAFB150DEB12800ULL,
+    0x7E789B2E6C442CB6ULL, 0xF41E5636C7E4F8C4ULL, 0x0959D150F8FBA7E4ULL, 0xA97316F13CDB9EEAULL,
+    0x74CD8258F9520068ULL, 0x55C74A62E116868BULL, 0xD2F4C799A2023CBDULL, 0xDF98CB79A37B51B9ULL,
+    0x396F5885524F3905ULL, 0xAF1D56386CA3B276ULL, 0xA9FFBE6B5104E85AULL, 0x6BD0C51B9FD533B3ULL,
+};
+
+// Mixes count stripes of 64 bytes into the 8 accumulators
+static void VL__HashAccumulate(u64 *acc, const u8 *data, size_t count, const u64 *key)
+{
+#if VL__HASH_SSE2
+    __m128i accs[4];
+    for(int i = 0; i < 4; i++) accs[i] = _mm_loadu_si128((const __m128i*)(acc + 2*i));
+    for(size_t s = 0; s < count; s++, data += VL__HASH_STRIPE_LEN) {
+        for(int i = 0; i < 4; i++) {
+            __m128i d = _mm_loadu_si128((const __m128i*)(data + 16*i));
+            __m128i dk = _mm_xor_si128(d, _mm_loadu_si128((const __m128i*)(key + 2*i)));
+            // low 32 bits * high 32 bits of each lane
+            __m128i product = _mm_mul_epu32(dk, _mm_shuffle_epi32(dk, _MM_SHUFFLE(0, 3, 0, 1)));
+            __m128i swapped = _mm_shuffle_epi32(d, _MM_SHUFFLE(1, 0, 3, 2));
+            accs[i] = _mm_add_epi64(accs[i], _mm_add_epi64(product, swapped));
+        }
+    }
+    for(int i = 0; i < 4; i++) _mm_storeu_si128((__m128i*)(acc + 2*i), accs[i]);
+#elif VL__HASH_NEON
+    uint64x2_t accs[4];
+    for(int i = 0; i < 4; i++) accs[i] = vld1q_u64(acc + 2*i);
+    for(size_t s = 0; s < count; s++, data += VL__HASH_STRIPE_LEN) {
+        for(int i = 0; i < 4; i++) {
+            uint64x2_t d = vreinterpretq_u64_u8(vld1q_u8(data + 16*i));
+            uint64x2_t dk = veorq_u64(d, vld1q_u64(key + 2*i));
+            uint64x2_t product = vmull_u32(vmovn_u64(dk), vshrn_n_u64(dk, 32));
+            uint64x2_t swapped = vextq_u64(d, d, 1);
+            accs[i] = vaddq_u64(accs[i], vaddq_u64(product, swapped));
+        }
+    }
+    for(int i = 0; i < 4; i++) vst1q_u64(acc + 2*i, accs[i]);
+#else
+    for(size_t s = 0; s < count; s++, data += VL__HASH_STRIPE_LEN) {
+        for(int i = 0; i < 8; i++) {
+            u64 d;
+            mem_copy_non_overlapping(&d, data + 8*i, sizeof(d));
+            u64 dk = d ^ key[i];
+            acc[i ^ 1] += d;
+            acc[i] += (dk & 0xFFFFFFFF)*(dk >> 32);
+        }
+    }
+#endif
+}
+
+// Not worth vectorizing, it's done once every 1KB
+static void VL__HashScramble(u64 *acc)
+{
+    for(int i = 0; i < 8; i++) {
+        acc[i] ^= acc[i] >> 47;
+        acc[i] ^= VL__hashSecret[8 + i];
+        acc[i] *= VL__HASH_PRIME32_1;
+    }
+}
+
+// 64x64->128 bit multiply, folded back to 64 bits
+static u64 VL__HashMulFold64(u64 a, u64 b)
+{
+#if defined(__SIZEOF_INT128__)
+    __uint128_t product = (__uint128_t)a*b;
+    return (u64)product ^ (u64)(product >> 64);
+#elif COMPILER_CL && ARCH_X64
+    u64 high;
+    u64 low = _umul128(a, b, &high);
+    return low ^ high;
+#else
+    u64 lowLow = (a & 0xFFFFFFFF)*(b & 0xFFFFFFFF);
+    u64 highLow = (a >> 32)*(b & 0xFFFFFFFF);
+    u64 lowHigh = (a & 0xFFFFFFFF)*(b >> 32);
+    u64 highHigh = (a >> 32)*(b >> 32);
+    u64 cross = (lowLow >> 32) + (highLow & 0xFFFFFFFF) + lowHigh;
+    u64 high = (highLow >> 32) + (cross >> 32) + highHigh;
+    u64 low = (cross << 32) | (lowLow & 0xFFFFFFFF);
+    return low ^ high;
+#endif
+}
+
+VLIBPROC u64 VL_Hash64(const void *data, size_t len, u64 seed)
+{
+    const u8 *bytes = (const u8*)data;
+    u64 acc[8] = {
+        VL__HASH_PRIME32_3, VL__HASH_PRIME64_1, VL__HASH_PRIME64_2, VL__HASH_PRIME64_3,
+        VL__HASH_PRIME64_4, VL__HASH_PRIME32_2, VL__HASH_PRIME64_5, VL__HASH_PRIME32_1,
+    };
+    u64 key[8];
+    for(int i = 0; i < 8; i++) {
+        key[i] = (i & 1) ? VL__hashSecret[i] - seed : VL__hashSecret[i] + seed;
+    }
+
+    if(len > VL__HASH_STRIPE_LEN) {
+        // NOTE: the last stripe always gets done separately, it can be partial
+        size_t stripes = (len - 1)/VL__HASH_STRIPE_LEN;
+        const u8 *at = bytes;
+        for(; stripes >= VL__HASH_STRIPES_PER_BLOCK; stripes -= VL__HASH_STRIPES_PER_BLOCK) {
+            VL__HashAccumulate(acc, at, VL__HASH_STRIPES_PER_BLOCK, key);
+            VL__HashScramble(acc);
+            at += VL__HASH_STRIPES_PER_BLOCK*VL__HASH_STRIPE_LEN;
+        }
+        VL__HashAccumulate(acc, at, stripes, key);
+        // overlaps with the previous stripe
+        VL__HashAccumulate(acc, bytes + len - VL__HASH_STRIPE_LEN, 1, key);
+    } else {
+        u8 stripe[VL__HASH_STRIPE_LEN] = {0};
+        if(len) mem_copy_non_overlapping(stripe, bytes, len);
+        VL__HashAccumulate(acc, stripe, 1, key);
+    }
+
+    u64 result = (u64)len*VL__HASH_PRIME64_1 ^ seed;
+    for(int i = 0; i < 4; i++) {
+        result += VL__HashMulFold64(acc[2*i] ^ VL__hashSecret[8 + 2*i], acc[2*i + 1] ^ VL__hashSecret[9 + 2*i]);
+    }
+
+    result ^= result >> 37;
+    result *= 0x165667919E3779F9ULL;
+    result ^= result >> 32;
+    return result;
+}
+
+////////////////////////////////
+
 struct vl_globalcontext VL_globalContext = {0};
 
 VLIBPROC bool VL_Init(void)
@@ -1856,6 +2096,15 @@ VLIBPROC bool VL_Pipe(vl_fd *fdRead, vl_fd *fdWrite)
         *fdWrite = descs[1];
     }
     return status == 0;
+#elif OS_MAC
+    // NOTE: no pipe2 on mac, so this isn't atomic with fork
+    vl_fd descs[2];
+    if(pipe(descs) != 0) return false;
+    fcntl(descs[0], F_SETFD, FD_CLOEXEC);
+    fcntl(descs[1], F_SETFD, FD_CLOEXEC);
+    *fdRead = descs[0];
+    *fdWrite = descs[1];
+    return true;
 #else
     // unimplemented...
     return false;
@@ -2275,7 +2524,7 @@ defer:
     return result;
 
 #elif OS_LINUX || OS_MAC
-    int fd = open(File, O_CREAT | O_WRONLY | O_TRUNC);
+    int fd = open(File, O_CREAT | O_WRONLY | O_TRUNC, S_IRUSR | S_IWUSR | S_IRGRP | S_IROTH);
     if(fd == -1) {
         if(errno == EACCES || errno == EPERM) VL_ErrorNumber = ERROR_FILE_ACCESS_DENIED;
         else if(errno == ENOMEM) VL_ErrorNumber = ERROR_NO_MEM;
@@ -2308,8 +2557,453 @@ defer:
 #endif
 }
 
+VLIBPROC bool VL_MapFile(vl_mapped_file *Map, const char *File)
+{
+    VL_ErrorNumber = ERROR_NO_ERROR;
+    Map->Data = 0;
+    Map->Size = 0;
+
+#if OS_WINDOWS
+    HANDLE FileHandle = CreateFileA(File, GENERIC_READ, FILE_SHARE_READ, 0, OPEN_EXISTING, 0, 0);
+    if(FileHandle == INVALID_HANDLE_VALUE) {
+        DWORD Error = GetLastError();
+        switch(Error) {
+            case ERROR_INVALID_DRIVE: fallthrough;
+            case ERROR_PATH_NOT_FOUND: fallthrough;
+            case ERROR_FILE_NOT_FOUND: VL_ErrorNumber = ERROR_READ_FILE_NOT_FOUND; break;
+            case ERROR_ACCESS_DENIED: VL_ErrorNumber = ERROR_FILE_ACCESS_DENIED; break;
+
+            default: VL_ErrorNumber = ERROR_READ_UNKNOWN; break;
+        }
+        return false;
+    }
+
+    LARGE_INTEGER FileSize;
+    if(!GetFileSizeEx(FileHandle, &FileSize)) {
+        VL_ErrorNumber = ERROR_READ_UNKNOWN;
+        CloseHandle(FileHandle);
+        return false;
+    }
+
+    // NOTE: can't map empty files on windows
+    if(FileSize.QuadPart > 0) {
+        // The view keeps the mapping and the file alive, the handles can be closed right away
+        HANDLE Mapping = CreateFileMappingA(FileHandle, 0, PAGE_READONLY, 0, 0, 0);
+        if(Mapping) {
+            Map->Data = (u8*)MapViewOfFile(Mapping, FILE_MAP_READ, 0, 0, 0);
+            CloseHandle(Mapping);
+        }
+        if(!Map->Data) {
+            VL_ErrorNumber = ERROR_NO_MEM;
+            CloseHandle(FileHandle);
+            return false;
+        }
+        Map->Size = (size_t)FileSize.QuadPart;
+    }
+    CloseHandle(FileHandle);
+#elif OS_LINUX || OS_MAC
+    int fd = open(File, O_RDONLY);
+    if(fd == -1) {
+        if(errno == EACCES || errno == EPERM) VL_ErrorNumber = ERROR_FILE_ACCESS_DENIED;
+        else if(errno == ENOMEM) VL_ErrorNumber = ERROR_NO_MEM;
+        else if(errno == EOVERFLOW) VL_ErrorNumber = ERROR_READ_FILE_TOO_BIG;
+        else if(errno == EBADF || errno == ENOENT)
+            VL_ErrorNumber = ERROR_READ_FILE_NOT_FOUND;
+        else VL_ErrorNumber = ERROR_READ_UNKNOWN;
+        return false;
+    }
+
+    struct stat stat;
+    if(fstat(fd, &stat) == -1) {
+        VL_ErrorNumber = ERROR_READ_UNKNOWN;
+        close(fd);
+        return false;
+    }
+
+    if(stat.st_size > 0) {
+        void *Data = mmap(0, (size_t)stat.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+        if(Data == MAP_FAILED) {
+            VL_ErrorNumber = ERROR_NO_MEM;
+            close(fd);
+            return false;
+        }
+        Map->Data = (u8*)Data;
+        Map->Size = (size_t)stat.st_size;
+    }
+    close(fd);
+#else
+#error Unsupported
+#endif
+    return true;
+}
+
+VLIBPROC void VL_UnmapFile(vl_mapped_file *Map)
+{
+    if(Map->Data) {
+#if OS_WINDOWS
+        UnmapViewOfFile(Map->Data);
+#else
+        munmap(Map->Data, Map->Size);
+#endif
+    }
+    Map->Data = 0;
+    Map->Size = 0;
+}
+
 #endif // !defined(VICLIB_NO_FILE_IO)
 
+#if !defined(VICLIB_NO_FILE_WATCH)
+
+#if COMPILER_CL
+# define VL__AtomicOr64(ptr, value) InterlockedOr64((volatile LONG64*)(ptr), (LONG64)(value))
+# define VL__AtomicAnd64(ptr, value) (u64)InterlockedAnd64((volatile LONG64*)(ptr), (LONG64)(value))
+# define VL__AtomicLoad64(ptr) (*(volatile u64*)(ptr))
+# define VL__AtomicLoad32(ptr) (u32)InterlockedOr((volatile LONG*)(ptr), 0)
+# define VL__AtomicStore32(ptr, value) InterlockedExchange((volatile LONG*)(ptr), (LONG)(value))
+#elif COMPILER_GCC || COMPILER_CLANG
+# define VL__AtomicOr64(ptr, value) __atomic_fetch_or((ptr), (value), __ATOMIC_RELEASE)
+# define VL__AtomicAnd64(ptr, value) __atomic_fetch_and((ptr), (value), __ATOMIC_ACQUIRE)
+# define VL__AtomicLoad64(ptr) __atomic_load_n((ptr), __ATOMIC_RELAXED)
+# define VL__AtomicLoad32(ptr) __atomic_load_n((ptr), __ATOMIC_ACQUIRE)
+# define VL__AtomicStore32(ptr, value) __atomic_store_n((ptr), (value), __ATOMIC_RELEASE)
+#endif
+
+// Without atomics (tcc) VL_WatchInit fails and the caller has to check the files itself
+#ifdef VL__AtomicOr64
+
+#if OS_WINDOWS
+static void VL__WatchReadDir(vl__watched_dir *Dir)
+{
+    ReadDirectoryChangesW(Dir->Handle, Dir->Buffer, sizeof(Dir->Buffer), FALSE,
+                          FILE_NOTIFY_CHANGE_FILE_NAME | FILE_NOTIFY_CHANGE_LAST_WRITE | FILE_NOTIFY_CHANGE_SIZE,
+                          0, &Dir->Overlapped, 0);
+}
+
+static DWORD WINAPI VL__WatchThread(LPVOID Data)
+{
+    vl_file_watch *Watch = (vl_file_watch*)Data;
+    HANDLE Handles[VL_WATCH_MAX_DIRS + 1];
+    u32 Started = 0;
+
+    // NOTE: the reads are started here since they get cancelled when the thread that started them exits
+    for(;;) {
+        u32 DirCount = VL__AtomicLoad32(&Watch->DirCount);
+        for(; Started < DirCount; Started++) VL__WatchReadDir(&Watch->Dirs[Started]);
+
+        Handles[0] = Watch->Wake;
+        for(u32 d = 0; d < DirCount; d++) Handles[d + 1] = Watch->Dirs[d].Overlapped.hEvent;
+        DWORD Wait = WaitForMultipleObjects(DirCount + 1, Handles, FALSE, INFINITE);
+        if(Wait == WAIT_OBJECT_0) {
+            if(Watch->Stop) break;
+            continue;
+        }
+        u32 d = Wait - WAIT_OBJECT_0 - 1;
+        if(d >= DirCount) break; // WAIT_FAILED
+
+        vl__watched_dir *Dir = &Watch->Dirs[d];
+        u32 Count = VL__AtomicLoad32(&Watch->Count);
+        u64 Changed = 0;
+        DWORD Size;
+        if(!GetOverlappedResult(Dir->Handle, &Dir->Overlapped, &Size, FALSE) || Size == 0) {
+            // The buffer overflowed, any file in this directory could have changed
+            for(u32 i = 0; i < Count; i++) {
+                if(Watch->Files[i].DirIndex == d) Changed |= 1ull << i;
+            }
+        } else {
+            FILE_NOTIFY_INFORMATION *Info = (FILE_NOTIFY_INFORMATION*)Dir->Buffer;
+            for(;;) {
+                char Name[MAX_PATH];
+                int NameLen = WideCharToMultiByte(CP_ACP, 0, Info->FileName, (int)(Info->FileNameLength/sizeof(WCHAR)),
+                                                  Name, sizeof(Name) - 1, 0, 0);
+                Name[NameLen] = 0;
+                if(Info->Action != FILE_ACTION_REMOVED && Info->Action != FILE_ACTION_RENAMED_OLD_NAME) {
+                    for(u32 i = 0; i < Count; i++) {
+                        vl__watched_file *File = &Watch->Files[i];
+                        if(File->DirIndex == d && !lstrcmpiA(Name, Watch->Names + File->Name)) Changed |= 1ull << i;
+                    }
+                }
+                if(!Info->NextEntryOffset) break;
+                Info = (FILE_NOTIFY_INFORMATION*)((u8*)Info + Info->NextEntryOffset);
+            }
+        }
+        if(Changed) VL__AtomicOr64(&Watch->Pending, Changed);
+        VL__WatchReadDir(Dir);
+    }
+
+    for(u32 d = 0; d < Started; d++) CancelIo(Watch->Dirs[d].Handle);
+    return 0;
+}
+#elif OS_LINUX
+static void *VL__WatchThread(void *Data)
+{
+    vl_file_watch *Watch = (vl_file_watch*)Data;
+    union {
+        struct inotify_event Event;
+        char Bytes[4096];
+    } Buffer;
+
+    for(;;) {
+        struct pollfd Fds[2] = {
+            {Watch->Fd, POLLIN, 0},
+            {Watch->WakeFd[0], POLLIN, 0},
+        };
+        if(poll(Fds, 2, -1) < 0) {
+            if(errno == EINTR) continue;
+            break;
+        }
+        if(Fds[1].revents) break; // VL_WatchEnd
+
+        ssize_t Size = read(Watch->Fd, Buffer.Bytes, sizeof(Buffer));
+        if(Size < 0 && errno == EINTR) continue;
+        if(Size <= 0) break;
+
+        u32 Count = VL__AtomicLoad32(&Watch->Count);
+        u64 Changed = 0;
+        for(char *At = Buffer.Bytes; At < Buffer.Bytes + Size;) {
+            struct inotify_event *Event = (struct inotify_event*)At;
+            At += sizeof(*Event) + Event->len;
+
+            if(Event->mask & IN_Q_OVERFLOW) {
+                Changed = ~0ull;
+                break;
+            }
+            if(Event->len == 0) continue;
+            for(u32 i = 0; i < Count; i++) {
+                vl__watched_file *File = &Watch->Files[i];
+                if(File->Wd == Event->wd && ViewEq(ViewFromCstr(Event->name), ViewFromCstr(Watch->Names + File->Name))) {
+                    Changed |= 1ull << i;
+                }
+            }
+        }
+        if(Changed) VL__AtomicOr64(&Watch->Pending, Changed);
+    }
+    return 0;
+}
+#elif OS_MAC
+static bool VL__WatchOpenFile(vl_file_watch *Watch, vl__watched_file *File)
+{
+    File->FileFd = openat(File->DirFd, Watch->Names + File->Name, O_EVTONLY);
+    if(File->FileFd < 0) return false;
+
+    struct kevent Change;
+    EV_SET(&Change, File->FileFd, EVFILT_VNODE, EV_ADD | EV_CLEAR,
+           NOTE_WRITE | NOTE_EXTEND | NOTE_ATTRIB | NOTE_DELETE | NOTE_RENAME, 0, 0);
+    kevent(Watch->Kq, &Change, 1, 0, 0, 0);
+    return true;
+}
+
+static void *VL__WatchThread(void *Data)
+{
+    vl_file_watch *Watch = (vl_file_watch*)Data;
+    struct kevent Events[64];
+
+    for(;;) {
+        int EventCount = kevent(Watch->Kq, 0, 0, Events, 64, 0);
+        if(EventCount < 0) {
+            if(errno == EINTR) continue;
+            break;
+        }
+
+        u32 Count = VL__AtomicLoad32(&Watch->Count);
+        u64 Changed = 0;
+        for(int e = 0; e < EventCount; e++) {
+            struct kevent *Event = &Events[e];
+            if(Event->filter == EVFILT_USER) return 0; // VL_WatchEnd
+
+            for(u32 i = 0; i < Count; i++) {
+                vl__watched_file *File = &Watch->Files[i];
+                if((int)Event->ident == File->FileFd) {
+                    Changed |= 1ull << i;
+                    if(Event->fflags & (NOTE_DELETE | NOTE_RENAME)) {
+                        // Replaced by another file, closing it also removes the event
+                        close(File->FileFd);
+                        VL__WatchOpenFile(Watch, File);
+                    }
+                } else if((int)Event->ident == File->DirFd && File->FileFd < 0) {
+                    // Something was added to the directory, maybe the file was created again
+                    if(VL__WatchOpenFile(Watch, File)) Changed |= 1ull << i;
+                }
+            }
+        }
+        if(Changed) VL__AtomicOr64(&Watch->Pending, Changed);
+    }
+    return 0;
+}
+#endif // OS
+
+VLIBPROC bool VL_WatchInit(vl_file_watch *Watch)
+{
+    mem_zero(Watch, sizeof(*Watch));
+#if OS_WINDOWS
+    Watch->Wake = CreateEventA(0, FALSE, FALSE, 0);
+    if(!Watch->Wake) return false;
+    Watch->Thread = CreateThread(0, 0, VL__WatchThread, Watch, 0, 0);
+    if(!Watch->Thread) {
+        CloseHandle(Watch->Wake);
+        return false;
+    }
+#elif OS_LINUX
+    Watch->Fd = inotify_init1(IN_CLOEXEC);
+    if(Watch->Fd < 0) return false;
+    if(pipe(Watch->WakeFd) < 0) {
+        close(Watch->Fd);
+        return false;
+    }
+    if(pthread_create(&Watch->Thread, 0, VL__WatchThread, Watch) != 0) {
+        close(Watch->Fd);
+        close(Watch->WakeFd[0]);
+        close(Watch->WakeFd[1]);
+        return false;
+    }
+#elif OS_MAC
+    Watch->Kq = kqueue();
+    if(Watch->Kq < 0) return false;
+    struct kevent Change;
+    EV_SET(&Change, 0, EVFILT_USER, EV_ADD | EV_CLEAR, 0, 0, 0);
+    if(kevent(Watch->Kq, &Change, 1, 0, 0, 0) < 0 ||
+       pthread_create(&Watch->Thread, 0, VL__WatchThread, Watch) != 0) {
+        close(Watch->Kq);
+        return false;
+    }
+#else
+#error Unsupported
+#endif
+    return true;
+}
+
+VLIBPROC u64 VL_WatchFile(vl_file_watch *Watch, const char *File)
+{
+    u32 Index = Watch->Count;
+    if(Index >= VL_WATCH_MAX_FILES) return 0;
+
+    size_t Len = strlen(File);
+    size_t NameStart = Len;
+    while(NameStart > 0 && File[NameStart - 1] != '/' && File[NameStart - 1] != '\\') NameStart--;
+    if(NameStart == Len) return 0; // no file name
+
+    // "name" -> ".", "/name" -> "/", "dir/name" -> "dir"
+    size_t DirLen = (NameStart > 1) ? NameStart - 1 : NameStart;
+    size_t NameLen = Len - NameStart;
+    if(Watch->NamesSize + DirLen + NameLen + 3 > VL_WATCH_NAMES_SIZE) return 0;
+
+    vl__watched_file *Watched = &Watch->Files[Index];
+    char *Names = Watch->Names;
+    u32 At = Watch->NamesSize;
+    Watched->Dir = At;
+    if(DirLen == 0) Names[At++] = '.';
+    mem_copy(Names + At, File, DirLen);
+    At += (u32)DirLen;
+    Names[At++] = 0;
+    Watched->Name = At;
+    mem_copy(Names + At, File + NameStart, NameLen);
+    At += (u32)NameLen;
+    Names[At++] = 0;
+    const char *Dir = Names + Watched->Dir;
+
+#if OS_WINDOWS
+    u32 DirIndex = 0;
+    for(; DirIndex < Watch->DirCount; DirIndex++) {
+        if(!lstrcmpiA(Names + Watch->Dirs[DirIndex].Dir, Dir)) break;
+    }
+    if(DirIndex == Watch->DirCount) {
+        if(DirIndex >= VL_WATCH_MAX_DIRS) return 0;
+        vl__watched_dir *WatchedDir = &Watch->Dirs[DirIndex];
+        WatchedDir->Handle = CreateFileA(Dir, FILE_LIST_DIRECTORY, FILE_SHARE_READ | FILE_SHARE_WRITE | FILE_SHARE_DELETE,
+                                         0, OPEN_EXISTING, FILE_FLAG_BACKUP_SEMANTICS | FILE_FLAG_OVERLAPPED, 0);
+        if(WatchedDir->Handle == INVALID_HANDLE_VALUE) return 0;
+        mem_zero(&WatchedDir->Overlapped, sizeof(WatchedDir->Overlapped));
+        WatchedDir->Overlapped.hEvent = CreateEventA(0, FALSE, FALSE, 0);
+        if(!WatchedDir->Overlapped.hEvent) {
+            CloseHandle(WatchedDir->Handle);
+            return 0;
+        }
+        WatchedDir->Dir = Watched->Dir;
+        VL__AtomicStore32(&Watch->DirCount, DirIndex + 1);
+        SetEvent(Watch->Wake);
+    }
+    Watched->DirIndex = DirIndex;
+#elif OS_LINUX
+    // Watching the same directory again returns the same descriptor
+    Watched->Wd = inotify_add_watch(Watch->Fd, Dir, IN_CLOSE_WRITE | IN_MOVED_TO);
+    if(Watched->Wd < 0) return 0;
+#elif OS_MAC
+    Watched->DirFd = -1;
+    for(u32 i = 0; i < Index; i++) {
+        if(ViewEq(ViewFromCstr(Names + Watch->Files[i].Dir), ViewFromCstr(Dir))) {
+            Watched->DirFd = Watch->Files[i].DirFd;
+            break;
+        }
+    }
+    if(Watched->DirFd < 0) {
+        Watched->DirFd = open(Dir, O_EVTONLY);
+        if(Watched->DirFd < 0) return 0;
+        struct kevent Change;
+        EV_SET(&Change, Watched->DirFd, EVFILT_VNODE, EV_ADD | EV_CLEAR, NOTE_WRITE, 0, 0);
+        kevent(Watch->Kq, &Change, 1, 0, 0, 0);
+    }
+    // NOTE: the file doesn't need to exist yet, it gets opened when it's added to the directory
+    VL__WatchOpenFile(Watch, Watched);
+#endif
+
+    Watch->NamesSize = At;
+    VL__AtomicStore32(&Watch->Count, Index + 1);
+    return 1ull << Index;
+}
+
+VLIBPROC u64 VL_WatchChanges(vl_file_watch *Watch, u64 Mask)
+{
+    u64 Changed = VL__AtomicLoad64(&Watch->Pending) & Mask;
+    if(Changed) Changed &= VL__AtomicAnd64(&Watch->Pending, ~Changed);
+    return Changed;
+}
+
+VLIBPROC void VL_WatchEnd(vl_file_watch *Watch)
+{
+#if OS_WINDOWS
+    Watch->Stop = true;
+    SetEvent(Watch->Wake);
+    WaitForSingleObject(Watch->Thread, INFINITE);
+    CloseHandle(Watch->Thread);
+    CloseHandle(Watch->Wake);
+    for(u32 d = 0; d < Watch->DirCount; d++) {
+        CloseHandle(Watch->Dirs[d].Overlapped.hEvent);
+        CloseHandle(Watch->Dirs[d].Handle);
+    }
+#elif OS_LINUX
+    ssize_t Ignore = write(Watch->WakeFd[1], "", 1);
+    (void)Ignore;
+    pthread_join(Watch->Thread, 0);
+    close(Watch->WakeFd[0]);
+    close(Watch->WakeFd[1]);
+    close(Watch->Fd);
+#elif OS_MAC
+    struct kevent Change;
+    EV_SET(&Change, 0, EVFILT_USER, 0, NOTE_TRIGGER, 0, 0);
+    kevent(Watch->Kq, &Change, 1, 0, 0, 0);
+    pthread_join(Watch->Thread, 0);
+    for(u32 i = 0; i < Watch->Count; i++) {
+        vl__watched_file *File = &Watch->Files[i];
+        if(File->FileFd >= 0) close(File->FileFd);
+        bool SharedDir = false;
+        for(u32 j = 0; j < i; j++) SharedDir |= (Watch->Files[j].DirFd == File->DirFd);
+        if(!SharedDir) close(File->DirFd);
+    }
+    close(Watch->Kq);
+#endif
+    mem_zero(Watch, sizeof(*Watch));
+}
+
+#else // !VL__AtomicOr64
+
+VLIBPROC bool VL_WatchInit(vl_file_watch *Watch) { mem_zero(Watch, sizeof(*Watch)); return false; }
+VLIBPROC u64 VL_WatchFile(vl_file_watch *Watch, const char *File) { (void)Watch; (void)File; return 0; }
+VLIBPROC u64 VL_WatchChanges(vl_file_watch *Watch, u64 Mask) { (void)Watch; (void)Mask; return 0; }
+VLIBPROC void VL_WatchEnd(vl_file_watch *Watch) { (void)Watch; }
+
+#endif // VL__AtomicOr64
+
+#endif // !defined(VICLIB_NO_FILE_WATCH)
+
 VLIBPROC const char *VL_GetError(void) {
     switch(VL_ErrorNumber) {
         case ERROR_READ_UNKNOWN: return "Unknown read error";
@@ -33,6 +33,7 @@
 #include <sys/types.h>
 #include <sys/wait.h>
 #include <sys/stat.h>
+#include <dirent.h>
 #endif
 
 #define VL_INC_STDIO_H
@@ -106,14 +107,26 @@ typedef struct {
     size_t capacity;
 } vl_file_paths;
 
+typedef enum {
+    VL_LINK_NONE = 0, /* plain copy */
+    VL_LINK_HARD, /* both paths are the same file, only for files that won't be modified */
+    VL_LINK_SYMBOLIC, /* points to the absolute path of the source */
+} vl_link_mode;
+
 struct VL_CopyDirectoryRecursively_opts {
     const char *src;
     const char *dst;
     const char *ext;
+    bool sync; /* skip the files that have the same size and are not older than the source */
+    vl_link_mode link; /* link the files instead of copying them, see VL_LinkOrCopyFile */
 };
 
 VLIBPROC bool MkdirIfNotExist(const char *path);
 VLIBPROC bool VL_CopyFile(const char *src, const char *dst);
+// Makes dst a hard or symbolic link to src, replacing it if it exists.
+// Falls back to VL_CopyFile when the link can't be made (different file systems,
+// no permission to make symlinks on windows, ...)
+VLIBPROC bool VL_LinkOrCopyFile(const char *src, const char *dst, vl_link_mode mode);
 #define VL_CopyDirectoryRecursively(src_path, ...) \
     VL_CopyDirectoryRecursively_Opt((struct VL_CopyDirectoryRecursively_opts){.src = (src_path), __VA_ARGS__})
 VLIBPROC bool VL_CopyDirectoryRecursively_Impl(const char *src_path, const char *dst_path, const char *ext);
@@ -122,6 +135,17 @@ VLIBPROC bool VL_ReadDirectoryFilesRecursively(const char *parent, vl_file_paths
 VLIBPROC bool VL_ReadEntireDir(const char *parent, vl_file_paths *children);
 VLIBPROC bool VL_DeleteFile(const char *path);
 
+struct VL_RemoveTree_opts {
+    const char *path;
+    bool parallel; /* remove each child of path in its own thread */
+};
+
+// Removes path and everything in it, like rm -rf. Symlinks get removed, not what they point to.
+// Every directory level uses an open file while it's removed, trees nested deeper than the open file limit fail.
+// Returns true if path doesn't exist
+#define VL_RemoveTree(tree_path, ...) VL_RemoveTree_Opt((struct VL_RemoveTree_opts){.path = (tree_path), __VA_ARGS__})
+VLIBPROC bool VL_RemoveTree_Opt(struct VL_RemoveTree_opts opt);
+
 // Initial capacity of a dynamic array
 #ifndef VL_DA_INIT_CAP
 # define VL_DA_INIT_CAP 256
@@ -196,6 +220,56 @@ VLIBPROC bool SbPadAlign(string_builder *sb, size_t size);
 #define SbAppendNull(sb) DaAppend(sb, 0)
 #define SbFree(sb) VL_FREE((sb).items)
 
+struct VL_WalkDir_opts {
+    const char *root;
+    memory_arena *arena; /* where the paths of the entries go, the temporary storage if NULL */
+    const char *ext; /* only the files ending with it */
+    bool filesOnly; /* don't return the directories, they still get walked */
+};
+
+typedef struct {
+    const char *path; /* root/.../name */
+    const char *name; /* points into path */
+    file_type type; /* symlinks are not followed */
+    size_t depth; /* 0 for the entries directly in root */
+} vl_walk_entry;
+
+typedef struct {
+#if OS_WINDOWS
+    HANDLE find;
+    WIN32_FIND_DATAA data;
+    bool hasData; /* data has an entry that wasn't returned yet */
+#else
+    DIR *dir;
+#endif
+    size_t pathLen; /* of this directory in vl_walk_dir.path */
+} vl__walk_frame;
+
+typedef struct {
+    memory_arena *arena;
+    const char *ext;
+    bool filesOnly;
+    string_builder path;
+    struct { vl__walk_frame *items; size_t count; size_t capacity; } stack;
+    bool pendingDir; /* the last entry was a directory, it's entered on the next call */
+} vl_walk_dir;
+
+// Walks the tree at root with one readdir per directory (or FindFirstFile on windows): the types come from the
+// directory entries and the directories are opened relative to their parent, nothing gets stat'd.
+//     vl_walk_dir walk;
+//     vl_walk_entry entry;
+//     if(VL_WalkDir(&walk, "shaders", .ext = ".hlsl")) {
+//         while(VL_WalkDirNext(&walk, &entry)) { ... }
+//         VL_WalkDirEnd(&walk);
+//     }
+#define VL_WalkDir(walk, root_path, ...) VL_WalkDir_Opt((walk), (struct VL_WalkDir_opts){.root = (root_path), __VA_ARGS__})
+VLIBPROC bool VL_WalkDir_Opt(vl_walk_dir *walk, struct VL_WalkDir_opts opt);
+// Returns false once every entry was returned
+VLIBPROC bool VL_WalkDirNext(vl_walk_dir *walk, vl_walk_entry *entry);
+// Don't go into the directory VL_WalkDirNext just returned
+VLIBPROC void VL_WalkDirSkip(vl_walk_dir *walk);
+VLIBPROC void VL_WalkDirEnd(vl_walk_dir *walk);
+
 typedef struct {
     vl_proc *items;
     size_t count;
@@ -208,12 +282,27 @@ VLIBPROC bool VL_ProcWait(vl_proc proc);
 // Pretty hard to understand, so it's marked as private
 VLIBPROC int VL__ProcWaitAsync(vl_proc proc, int ms);
 
+// Waits until any of the processes has finished, or ms milliseconds have passed (ms < 0 waits forever).
+// Returns the index of the finished process in procs, or -1 if none finished.
+// *ok (can be NULL) is set to false if the process failed or couldn't be waited on
+VLIBPROC int VL_ProcsWaitAny(vl_procs procs, int ms, bool *ok);
+
 // Wait until all the processes have finished
 VLIBPROC bool VL_ProcsWait(vl_procs procs);
 
 // Wait until all the processes have finished and empty the procs array.
 VLIBPROC bool VL_ProcsFlush(vl_procs *procs);
 
+// The sleep between the checks of a watch loop, returns true as soon as one of procs exits
+// (e.g. the program that is being rebuilt, procs can be empty)
+VLIBPROC bool VL_WatchSleep(vl_procs procs, int ms);
+
+#if !defined(VICLIB_NO_FILE_WATCH)
+// Watches every file under directory ending with ext (all of them if NULL), returns their bits for VL_WatchChanges.
+// NOTE: files added after this aren't watched
+VLIBPROC u64 VL_WatchDirectory(vl_file_watch *watch, const char *directory, const char *ext);
+#endif
+
 typedef struct {
     const char **items;
     size_t count;
@@ -233,8 +322,76 @@ typedef struct {
     const char *stdinPath;
     const char *stdoutPath;
     const char *stderrPath;
+    // Collect stdout and stderr (unless they are redirected to a file) and print them all at once when the
+    // command finishes, so the output of async commands doesn't get mixed up
+    bool captureOutput;
+    // Run the command in this directory instead of the current one. Relative paths in the command are
+    // relative to it, except for the program itself on windows (use an absolute path for that)
+    const char *workingDir;
 } vl_cmd_opts;
 
+// A command run by CmdRun
+typedef struct {
+    vl_proc proc;
+    vl_fd output; // read end of the captured output, VL_INVALID_FD if it's not captured
+#if OS_LINUX
+    int pidfd; // pidfd of proc to poll on while it's running, -1 if it couldn't be opened
+#endif
+    string_builder text; // captured output that wasn't printed yet
+    char *name; // rendered command
+    u64 start; // nanoseconds
+    u64 end; // 0 while it's running
+} vl_job;
+
+typedef struct {
+    vl_job *items;
+    size_t count;
+    size_t capacity;
+} vl_jobs;
+
+extern vl_jobs VL_jobs;
+
+// Prints how long each finished command run by CmdRun took (slowest first) and forgets about them
+VLIBPROC void VL_PrintJobSummary(void);
+
+// Finished jobs kept for VL_PrintJobSummary, once there are this many the oldest half is forgotten
+// so they don't pile up when the summary is never printed (e.g. a watch loop rebuilding forever)
+#ifndef VL_MAX_FINISHED_JOBS
+#define VL_MAX_FINISHED_JOBS 1024
+#endif
+
+// Default value of VL_Tracing
+#ifndef VL_BUILD_TRACE
+#define VL_BUILD_TRACE 0
+#endif // VL_BUILD_TRACE
+
+typedef struct {
+    const char *category; // "cmd", "copy", "copydir", "rebuild", "remove" or your own
+    char *name;
+    u64 start; // nanoseconds, from VL_TraceClock
+    u64 end;
+} vl_trace_event;
+
+typedef struct {
+    vl_trace_event *items;
+    size_t count;
+    size_t capacity;
+} vl_trace_events;
+
+// If set, every command run by CmdRun and every VL_CopyFile, VL_CopyDirectoryRecursively and
+// VL_Needs_C_Rebuild call gets recorded in VL_traceEvents
+extern bool VL_Tracing;
+extern vl_trace_events VL_traceEvents;
+
+VLIBPROC u64 VL_TraceClock(void);
+// Records an event from start until now if VL_Tracing is set, name gets copied
+VLIBPROC void VL_TraceSpan(const char *category, const char *name, u64 start);
+// Prints the time spent in each category and the slowest events
+VLIBPROC void VL_PrintTraceSummary(void);
+// Writes the events as a chrome trace (open it in https://ui.perfetto.dev or spall).
+// The commands get their own rows, so you can see which ones ran in parallel and which one everything waited on
+VLIBPROC bool VL_WriteTrace(const char *path);
+
 // Render a string representation of a command into a string builder. Keep in mind the the
 // string builder is not NULL-terminated by default. Use SbAppendNull if you plan to
 // use it as a C string.
@@ -254,9 +411,12 @@ VLIBPROC bool CmdRun_Opt(vl_cmd_opts opt);
 
 #define CmdFree(cmd) VL_FREE(cmd.items)
 
+// Number of cores, or the VL_BUILD_JOBS environment variable when it is set (e.g. by a parent build running several at once)
 VLIBPROC int VL_GetCountProcs(void);
 
 VLIBPROC vl_proc VL_CmdStartProcess(vl_cmd cmd, vl_fd *fdin, vl_fd *fdout, vl_fd *fderr, bool render);
+// Same as VL_CmdStartProcess, running it in workingDir (the current directory if it's NULL)
+VLIBPROC vl_proc VL_CmdStartProcessIn(vl_cmd cmd, vl_fd *fdin, vl_fd *fdout, vl_fd *fderr, bool render, const char *workingDir);
 
 VLIBPROC char *temp_sprintf(const char *fmt, ...) VL_PRINTF_FORMAT(1, 2);
 
@@ -290,10 +450,15 @@ VLIBPROC bool VL_GetLastWriteTime(const char *file, u64 *writeTime);
 #define VL_NeedsRebuild(out, in, ...) VL_NeedsRebuild_Impl(out, ((const char*[]){in, __VA_ARGS__}), sizeof((const char*[]){in, __VA_ARGS__})/sizeof(const char*))
 VLIBPROC int VL_NeedsRebuild_Impl(const char *output_path, const char **input_paths, size_t input_paths_count);
 
+// Same as VL_NeedsRebuild but the inputs are input and everything in depfile, a make style
+// dependency file like the ones gcc -MD or glslc -MD write next to output. Without a depfile
+// (never built) only input is checked. Paths with spaces in the depfile are not supported
+VLIBPROC int VL_NeedsRebuildDepfile(const char *output_path, const char *input_path, const char *depfile);
+
 typedef struct vl_filetime_node vl_filetime_node;
 struct vl_filetime_node {
     view file;
-    u64 time;
+    u64 time; // 0 if the file doesn't exist
     //bool exploredAllDependencies;
     vl_filetime_node *next;
 };
@@ -302,8 +467,44 @@ struct vl_filetime_node {
 #define VL_BUILD_FILETIME_TABLE_SIZE 1024
 #endif // VL_BUILD_FILETIME_TABLE_SIZE
 
+// Memory used for the filetime nodes and their paths, allocated on first use
+#ifndef VL_BUILD_FILETIME_ARENA_SIZE
+#define VL_BUILD_FILETIME_ARENA_SIZE (4*1024*1024)
+#endif // VL_BUILD_FILETIME_ARENA_SIZE
+
+#ifndef VL_BUILD_CACHE_DIR
+#define VL_BUILD_CACHE_DIR ".vl_cache"
+#endif // VL_BUILD_CACHE_DIR
+
+#ifndef VL_BUILD_DEPS_CACHE_PATH
+#define VL_BUILD_DEPS_CACHE_PATH VL_BUILD_CACHE_DIR "/deps.bin"
+#endif // VL_BUILD_DEPS_CACHE_PATH
+
+#ifndef VL_BUILD_HASH_CACHE_PATH
+#define VL_BUILD_HASH_CACHE_PATH VL_BUILD_CACHE_DIR "/hashes.bin"
+#endif // VL_BUILD_HASH_CACHE_PATH
+
+// Default value of VL_ContentHashRebuilds
+#ifndef VL_BUILD_CONTENT_HASH
+#define VL_BUILD_CONTENT_HASH 0
+#endif // VL_BUILD_CONTENT_HASH
+
+// Default value of VL_CompileCache
+#ifndef VL_BUILD_COMPILE_CACHE
+#define VL_BUILD_COMPILE_CACHE 0
+#endif // VL_BUILD_COMPILE_CACHE
+
+#ifndef VL_BUILD_COMPILE_CACHE_DIR
+#define VL_BUILD_COMPILE_CACHE_DIR VL_BUILD_CACHE_DIR "/objects"
+#endif // VL_BUILD_COMPILE_CACHE_DIR
+
+// The least recently used objects get deleted when the cache gets bigger than this
+#ifndef VL_BUILD_COMPILE_CACHE_MAX_SIZE
+#define VL_BUILD_COMPILE_CACHE_MAX_SIZE (1024ull*1024*1024)
+#endif // VL_BUILD_COMPILE_CACHE_MAX_SIZE
+
 typedef struct {
-    vl_filetime_node *items;
+    vl_filetime_node *items; // VL_BUILD_FILETIME_TABLE_SIZE buckets, the first node of each one lives here
     size_t count;
     size_t capacity;
 } vl_filetime_nodelist;
@@ -313,15 +514,71 @@ typedef struct {
     uint32_t countTimes;
 } vl_filetime_table;
 
+// Everything an output was built from the last time its #includes were scanned
+typedef struct vl_deps_entry vl_deps_entry;
+struct vl_deps_entry {
+    view output;
+    u64 cmdHash; // hash of the compile flags
+    u32 depCount;
+    view *deps; // source files + #included files
+    u64 *times; // filetime of each dependency when it was scanned
+    vl_deps_entry *next;
+};
+
+// Content hash of a file, or for outputs: the combined hash of all their inputs when they were up to date
+typedef struct vl_hash_entry vl_hash_entry;
+struct vl_hash_entry {
+    view path;
+    u64 size; // 0 for outputs
+    u64 time; // filetime of the file when it got hashed
+    u64 hash;
+    vl_hash_entry *next;
+};
+
 typedef struct {
     vl_filetime_table table;
     vl_filetime_node *freelist;
     vl_file_paths *includePaths;
     memory_arena *Arena;
+
+    vl_deps_entry *deps; // loaded from VL_BUILD_DEPS_CACHE_PATH on first use
+    bool depsLoaded;
+    bool depsChanged;
+
+    vl_hash_entry *fileHashes; // loaded from VL_BUILD_HASH_CACHE_PATH on first use
+    vl_hash_entry *outputStamps;
+    bool hashesLoaded;
+    bool hashesChanged;
+
+    bool batchSaves; // while set the caches are only marked as changed, they get saved once when it's cleared
 } vl_needrebuild_context;
 
 extern vl_needrebuild_context VL_needsRebuildContext;
 
+// Precise last write time (0 if the file doesn't exist). Each file is only stat'd once,
+// call VL_ForgetFileTimes if the files could have changed since then (e.g. in a watch loop)
+VLIBPROC u64 VL_GetCachedFileTime(view file);
+VLIBPROC void VL_ForgetFileTimes(void);
+
+// If set, an output is not rebuilt when its inputs are newer but have the same contents as the
+// last time it was up to date (e.g. after a git checkout or copying the files again).
+// Applies to VL_NeedsRebuild, VL_Needs_C_Rebuild and VL_GO_REBUILD_URSELF
+extern bool VL_ContentHashRebuilds;
+
+// If set, VL_CCompile keeps every object it compiles in VL_CompileCacheDir, keyed by the compiler version,
+// the flags and the preprocessed source. When the same object is needed again (a clean build, going back
+// to an older version of a file) it gets copied from there instead of compiled. The default directory is
+// relative, so every checkout has its own; point it at a shared absolute path to reuse objects between them.
+// .debug objects record the working directory, so those are only reused from the same one
+// Applies to Compile_Object with a single source file and to every object of .parallel
+extern bool VL_CompileCache;
+extern const char *VL_CompileCacheDir;
+extern u64 VL_CompileCacheMaxSize;
+
+// Hash of the contents of a file. It is cached in VL_BUILD_HASH_CACHE_PATH by path, size and filetime,
+// so a file is only read again when it changes
+VLIBPROC bool VL_GetFileHash(const char *path, u64 *hash);
+
 #ifndef VL_BUILD_FILENAME_HASH
 #define VL_BUILD_FILENAME_HASH(v, hash) do {\
     /* djb2 */ \
@@ -408,6 +665,7 @@ typedef enum {
     Compile_Object,
     Compile_DynamicLibrary,
     Compile_StaticLibrary,
+    Compile_PrecompiledHeader, /* only used by VL_PrecompileHeader */
 } vl_compile_type;
 
 typedef enum {
@@ -426,9 +684,14 @@ typedef struct {
     bool gcSections; /* adds "-Wl,--gc-sections", "-opt:ref" or nothing */
     bool warnings; /* adds "-Wall -Wextra", "-W4" or nothing */
     bool warningsAsErrors; /* adds "-Werror", "-WX" or nothing */
+    bool parallel; /* compiles each source file to its own object in objectDir (only the stale ones), then links them */
+    size_t unityBatchSize; /* > 0 compiles outputDir/unity/unity_N.c files that #include this many source files each */
     vl_file_paths sourceFiles;
-    const char *output;
+    const char *outputPath;
     const char *outputDir;
+    const char *objectDir; /* only used with .parallel, outputDir/obj by default */
+    const char *precompiledHeader; /* gets precompiled once into pchDir and used by every source file */
+    const char *pchDir; /* only used with .precompiledHeader, outputDir/pch by default */
     vl_file_paths includePaths;
     vl_file_paths extraCompilerFlags;
 
@@ -449,7 +712,7 @@ vl_compile_ctx ctx = {
     .debug = true,
     .warnings = true,
     .sourceFiles = VL_GetDaStrSlice("main.c"),
-    .output = "example", // extension is added in VL_CCompile()
+    .outputPath = "example", // extension is added in VL_CCompile()
 };
 // default output is executable
 if(!VL_CCompile(&cmd, &ctx)) {
@@ -461,7 +724,17 @@ VLIBPROC bool VL_CCompile_Opt(vl_compile_ctx *ctx, vl_cmd_opts opt);
 #define VL_CCompile(Cmd, ctx, ...) \
     VL_CCompile_Opt((ctx), (vl_cmd_opts){.cmd = (Cmd), __VA_ARGS__})
 
-// Checks the filetime of all input files and all files #included by them
+// Appends the compiler command for ctx to cmd without running it, so you can add more flags.
+// Doesn't do anything special for .parallel or Compile_StaticLibrary
+VLIBPROC void VL_SetupCCompile(vl_cmd *cmd, vl_compile_ctx *ctx);
+
+// Precompiles ctx->precompiledHeader into ctx->pchDir if it's stale (.gch for gcc, .pch for clang, /Yc for msvc).
+// VL_CCompile does this for you, call it yourself before VL_SetupCCompile
+VLIBPROC bool VL_PrecompileHeader(vl_compile_ctx *ctx);
+
+// Checks the filetime of all input files and all files #included by them.
+// The #include list is kept in VL_BUILD_DEPS_CACHE_PATH so the compiler only has to be asked
+// again when one of the files changed, changing the compile flags also means a rebuild
 VLIBPROC int VL_Needs_C_Rebuild(vl_cmd *cmd, vl_compile_ctx *ctx);
 
 VLIBPROC char *VL_GetFilePathFromCompileCtx(vl_compile_ctx *ctx);
@@ -546,7 +819,7 @@ vl_compile_ctx ctx = {
     .debug = true,
     .warnings = true,
     .sourceFiles = VL_GetDaStrSlice("main.c"),
-    .output = "example",
+    .outputPath = "example",
     .includePaths = VL_GetDaStrSlice("include"),
     .extraCompilerFlags = sdlInfo.extraCompilerFlags, // used for rpath
     .libs = sdlInfo.libs,
@@ -591,11 +864,12 @@ bool Install_SDL3(vl_cmd *cmd, vl_install_info *info);
 #  define VL_CC_DEBUG_INFO "-g"
 # endif
 #else
+// NOTE: -pthread since VL_CopyDirectoryRecursively uses threads, older glibc versions need it
 # if defined(__cplusplus)
-#  define VL_DEFAULT_REBUILD_URSELF(bin_path, src_path) "cc", "-x", "c++", "-o", bin_path, src_path, "-Wall", "-Wextra"
+#  define VL_DEFAULT_REBUILD_URSELF(bin_path, src_path) "cc", "-x", "c++", "-o", bin_path, src_path, "-Wall", "-Wextra", "-pthread"
 #  define VL_CC_DEBUG_INFO "-g"
 # else
-#  define VL_DEFAULT_REBUILD_URSELF(bin_path, src_path) "cc", "-x", "c", "-o", bin_path, src_path, "-Wall", "-Wextra"
+#  define VL_DEFAULT_REBUILD_URSELF(bin_path, src_path) "cc", "-x", "c", "-o", bin_path, src_path, "-Wall", "-Wextra", "-pthread"
 #  define VL_CC_DEBUG_INFO "-g"
 # endif
 #endif
@@ -618,7 +892,19 @@ VLIBPROC char *Win32_ErrorMessage(DWORD err);
 vl_log_level VL_MinimalLogLevel = VL_ECHO;
 
 #if !OS_WINDOWS
-#include <dirent.h>
+#include <utime.h>
+#include <pthread.h>
+#endif
+#if OS_LINUX
+#include <sys/syscall.h>
+#include <sys/ioctl.h>
+#include <sys/sendfile.h>
+#ifndef FICLONE
+#define FICLONE _IOW(0x94, 9, int)
+#endif
+#elif OS_MAC
+#include <sys/event.h>
+#include <copyfile.h>
 #endif
 
 #if OS_WINDOWS
@@ -717,10 +1003,33 @@ VLIBPROC bool MkdirIfNotExist(const char *path)
     return true;
 }
 
-VLIBPROC bool VL_CopyFile(const char *src, const char *dst)
+#if OS_WINDOWS
+// Same volume serial number and file index means they're hard links to the same file
+static bool VL__Win32SameFile(const char *a, const char *b)
+{
+    bool result = false;
+    DWORD share = FILE_SHARE_READ | FILE_SHARE_WRITE | FILE_SHARE_DELETE;
+    HANDLE fileA = CreateFileA(a, 0, share, 0, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, 0);
+    HANDLE fileB = CreateFileA(b, 0, share, 0, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, 0);
+    BY_HANDLE_FILE_INFORMATION infoA, infoB;
+    if((fileA != INVALID_HANDLE_VALUE) && (fileB != INVALID_HANDLE_VALUE) &&
+       GetFileInformationByHandle(fileA, &infoA) && GetFileInformationByHandle(fileB, &infoB)) {
+        result = (infoA.dwVolumeSerialNumber == infoB.dwVolumeSerialNumber) &&
+                 (infoA.nFileIndexHigh == infoB.nFileIndexHigh) &&
+                 (infoA.nFileIndexLow == infoB.nFileIndexLow);
+    }
+    if(fileA != INVALID_HANDLE_VALUE) CloseHandle(fileA);
+    if(fileB != INVALID_HANDLE_VALUE) CloseHandle(fileB);
+    return result;
+}
+#endif
+
+static bool VL__CopyFile(const char *src, const char *dst)
 {
-    VL_Log(VL_ECHO, "copying %s -> %s", src, dst);
 #if OS_WINDOWS
+    // NOTE: dst can be a hard link to src (see VL_LinkOrCopyFile), copying over it would empty both
+    if(VL__Win32SameFile(src, dst)) return true;
+
     if(!CopyFile(src, dst, false)) {
         VL_Log(VL_ERROR, "Could not copy file: %s", Win32_ErrorMessage(GetLastError()));
         return false;
@@ -730,10 +1039,7 @@ VLIBPROC bool VL_CopyFile(const char *src, const char *dst)
     int src_fd = -1;
     int dst_fd = -1;
     size_t bufSize = 32*1024;
-    size_t tempMark = temp_save();
-    char *buf = (char*)temp_alloc(bufSize, .Alignment = 1);
-
-    Assert(buf != NULL && "Buy more RAM lol!!");
+    char *buf = 0; // NOTE: not from the temporary storage, files can be copied from multiple threads
     bool result = true;
 
     src_fd = open(src, O_RDONLY);
@@ -748,12 +1054,61 @@ VLIBPROC bool VL_CopyFile(const char *src, const char *dst)
         VL_ReturnDefer(false);
     }
 
+    // NOTE: dst can be a hard link to src (see VL_LinkOrCopyFile), truncating it would empty both
+    struct stat dst_stat;
+    if((stat(dst, &dst_stat) == 0) && (dst_stat.st_dev == src_stat.st_dev) && (dst_stat.st_ino == src_stat.st_ino)) {
+        VL_ReturnDefer(true);
+    }
+
     dst_fd = open(dst, O_CREAT | O_TRUNC | O_WRONLY, src_stat.st_mode);
     if(dst_fd < 0) {
         VL_Log(VL_ERROR, "Could not create file %s: %s", dst, strerror(errno));
         VL_ReturnDefer(false);
     }
 
+    // NOTE: each of these falls through to the next one if it's not supported by the file systems,
+    // so they can only fail before anything was copied
+#if OS_LINUX
+    // NOTE: files like the ones in /proc say they're empty, they only get copied by the read/write loop
+    if(S_ISREG(src_stat.st_mode) && (src_stat.st_size > 0)) {
+        // Shares the blocks of the file on btrfs, xfs, etc. until one of them gets written
+        if(ioctl(dst_fd, FICLONE, src_fd) == 0) VL_ReturnDefer(true);
+
+        off_t remaining = src_stat.st_size;
+# ifdef SYS_copy_file_range
+        // In-kernel copy, it can also reflink or copy server side on NFS/SMB
+        while(remaining > 0) {
+            ssize_t n = syscall(SYS_copy_file_range, src_fd, 0, dst_fd, 0, (size_t)remaining, 0);
+            if((n < 0) && (errno == EINTR)) continue;
+            if(n <= 0) break;
+            remaining -= n;
+        }
+# endif
+        // Older kernels can't copy_file_range across file systems
+        if(remaining == src_stat.st_size) {
+            while(remaining > 0) {
+                ssize_t n = sendfile(dst_fd, src_fd, 0, (size_t)remaining);
+                if((n < 0) && (errno == EINTR)) continue;
+                if(n <= 0) break;
+                remaining -= n;
+            }
+        }
+        if(remaining == 0) VL_ReturnDefer(true);
+        if(remaining != src_stat.st_size) {
+            VL_Log(VL_ERROR, "Could not copy file %s to %s: %s", src, dst, strerror(errno));
+            VL_ReturnDefer(false);
+        }
+    }
+#elif OS_MAC
+    if(fcopyfile(src_fd, dst_fd, 0, COPYFILE_DATA) == 0) VL_ReturnDefer(true);
+    if((lseek(src_fd, 0, SEEK_SET) < 0) || (lseek(dst_fd, 0, SEEK_SET) < 0) || (ftruncate(dst_fd, 0) < 0)) {
+        VL_Log(VL_ERROR, "Could not copy file %s to %s: %s", src, dst, strerror(errno));
+        VL_ReturnDefer(false);
+    }
+#endif
+
+    buf = (char*)VL_REALLOC(0, bufSize);
+    Assert(buf != NULL && "Buy more RAM lol!!");
     for(;;) {
         ssize_t n = read(src_fd, buf, bufSize);
         if(n == 0) break;
@@ -774,13 +1129,65 @@ VLIBPROC bool VL_CopyFile(const char *src, const char *dst)
     }
 
 defer:
-    temp_rewind(tempMark);
+    VL_FREE(buf);
     close(src_fd);
     close(dst_fd);
     return result;
 #endif
 }
 
+VLIBPROC bool VL_CopyFile(const char *src, const char *dst)
+{
+    VL_Log(VL_ECHO, "copying %s -> %s", src, dst);
+    u64 traceStart = VL_TraceClock();
+    bool ok = VL__CopyFile(src, dst);
+    if(VL_Tracing) VL_TraceSpan("copy", temp_sprintf("%s -> %s", src, dst), traceStart);
+    return ok;
+}
+
+static const char *VL__temp_AbsolutePath(const char *path);
+
+// Doesn't log, so it can be called from multiple threads. For symlinks src has to be an absolute path
+static bool VL__LinkFile(const char *src, const char *dst, vl_link_mode mode)
+{
+#if OS_WINDOWS
+    DeleteFileA(dst);
+    switch(mode) {
+        case VL_LINK_HARD: return CreateHardLinkA(dst, src, 0);
+        case VL_LINK_SYMBOLIC: return CreateSymbolicLinkA(dst, src, 0x2 /* SYMBOLIC_LINK_FLAG_ALLOW_UNPRIVILEGED_CREATE */);
+        default: return false;
+    }
+#else
+    // NOTE: if dst was a hard link to src this only removes the link
+    if((unlink(dst) < 0) && (errno != ENOENT)) return false;
+    switch(mode) {
+        case VL_LINK_HARD: return link(src, dst) == 0;
+        case VL_LINK_SYMBOLIC: return symlink(src, dst) == 0;
+        default: return false;
+    }
+#endif
+}
+
+VLIBPROC bool VL_LinkOrCopyFile(const char *src, const char *dst, vl_link_mode mode)
+{
+    if(mode == VL_LINK_NONE) return VL_CopyFile(src, dst);
+
+    VL_Log(VL_ECHO, "linking %s -> %s", src, dst);
+    u64 traceStart = VL_TraceClock();
+    size_t mark = temp_save();
+    if(mode == VL_LINK_SYMBOLIC) src = VL__temp_AbsolutePath(src);
+
+    bool ok = src && VL__LinkFile(src, dst, mode);
+    if(!ok && src) {
+        // Copying reflinks when it can, which is the next best thing
+        VL_Log(VL_INFO, "Could not link %s, copying it instead", dst);
+        ok = VL__CopyFile(src, dst);
+    }
+    if(VL_Tracing) VL_TraceSpan("copy", temp_sprintf("%s -> %s", src, dst), traceStart);
+    temp_rewind(mark);
+    return ok;
+}
+
 VLIBPROC bool VL_CopyDirectoryRecursively_Impl(const char *src, const char *dst, const char *ext)
 {
     bool result = true;
@@ -845,144 +1252,715 @@ defer:
     return result;
 }
 
-VLIBPROC bool VL_CopyDirectoryRecursively_Opt(struct VL_CopyDirectoryRecursively_opts opt)
+// Work that VL__ParallelFor splits between threads, it must not use the temporary storage (it's not thread safe)
+typedef void vl__parallel_proc(void *data, size_t index);
+
+typedef struct {
+    vl__parallel_proc *proc;
+    void *data;
+    size_t count;
+    volatile s64 next;
+} vl__parallel_for;
+
+#if COMPILER_CL
+# define VL__AtomicFetchAdd64(ptr, value) InterlockedExchangeAdd64((ptr), (value))
+#elif COMPILER_GCC || COMPILER_CLANG
+# define VL__AtomicFetchAdd64(ptr, value) __atomic_fetch_add((ptr), (value), __ATOMIC_RELAXED)
+#endif
+
+#ifndef VL_BUILD_MAX_THREADS
+#define VL_BUILD_MAX_THREADS 64
+#endif // VL_BUILD_MAX_THREADS
+
+static void VL__ParallelForWork(vl__parallel_for *work)
 {
-    AssertMsg(opt.src != 0, "Invalid parameter: src directory is null");
-    if(opt.dst == 0) opt.dst = ".";
-    if(opt.ext == 0) opt.ext = "";
+    for(;;) {
+#ifdef VL__AtomicFetchAdd64
+        s64 i = VL__AtomicFetchAdd64(&work->next, 1);
+#else
+        s64 i = work->next++;
+#endif
+        if(i >= (s64)work->count) break;
+        work->proc(work->data, (size_t)i);
+    }
+}
 
-    VL_Log(VL_ECHO, "copying %s/*%s -> %s", opt.src, opt.ext, opt.dst);
+#ifdef VL__AtomicFetchAdd64
+# if OS_WINDOWS
+static DWORD WINAPI VL__ParallelForThread(LPVOID param)
+{
+    VL__ParallelForWork((vl__parallel_for*)param);
+    return 0;
+}
+# else
+static void *VL__ParallelForThread(void *param)
+{
+    VL__ParallelForWork((vl__parallel_for*)param);
+    return 0;
+}
+# endif
+#endif
 
-    vl_log_level prevLogLevel = VL_MinimalLogLevel;
-    VL_MinimalLogLevel = VL_INFO;
-    bool ok = VL_CopyDirectoryRecursively_Impl(opt.src, opt.dst, opt.ext);
-    VL_MinimalLogLevel = prevLogLevel;
+// Calls proc(data, i) for every i < count from up to threadCount threads (including the calling one).
+// Without atomics (tcc) everything runs on the calling thread
+static void VL__ParallelFor(size_t count, size_t threadCount, vl__parallel_proc *proc, void *data)
+{
+    vl__parallel_for work = {proc, data, count, 0};
+#ifdef VL__AtomicFetchAdd64
+# if OS_WINDOWS
+    HANDLE threads[VL_BUILD_MAX_THREADS];
+# else
+    pthread_t threads[VL_BUILD_MAX_THREADS];
+# endif
+    size_t extraThreads = min(min(threadCount, count), (size_t)VL_BUILD_MAX_THREADS);
+    extraThreads = extraThreads > 0 ? extraThreads - 1 : 0;
+    size_t started = 0;
+    for(; started < extraThreads; started++) {
+        // NOTE: if a thread can't be started the ones that did (and this one) do its share
+# if OS_WINDOWS
+        threads[started] = CreateThread(0, 0, VL__ParallelForThread, &work, 0, 0);
+        if(!threads[started]) break;
+# else
+        if(pthread_create(&threads[started], 0, VL__ParallelForThread, &work) != 0) break;
+# endif
+    }
+#else
+    (void)threadCount;
+#endif
 
-    return ok;
+    VL__ParallelForWork(&work);
+
+#ifdef VL__AtomicFetchAdd64
+    for(size_t i = 0; i < started; i++) {
+# if OS_WINDOWS
+        WaitForSingleObject(threads[i], INFINITE);
+        CloseHandle(threads[i]);
+# else
+        pthread_join(threads[i], 0);
+# endif
+    }
+#endif
 }
 
-VLIBPROC bool VL_ReadDirectoryFilesRecursively(const char *parent, vl_file_paths *children)
+typedef struct {
+    vl_file_paths src;
+    vl_file_paths dst;
+    u8 *status;
+    bool sync;
+    vl_link_mode link;
+} vl__copy_batch;
+
+enum {
+    VL__COPY_SKIPPED = 0,
+    VL__COPY_DONE,
+    VL__COPY_FAILED,
+};
+
+static u64 VL__FileTimeAndSize(const char *path, u64 *size);
+
+static void VL__CopyBatchProc(void *data, size_t i)
 {
-    bool result = true;
+    vl__copy_batch *batch = (vl__copy_batch*)data;
+    if(batch->sync) {
+        u64 srcSize, dstSize;
+        u64 srcTime = VL__FileTimeAndSize(batch->src.items[i], &srcSize);
+        u64 dstTime = VL__FileTimeAndSize(batch->dst.items[i], &dstSize);
+        // NOTE: a copy is newer than its source, or as old on windows since CopyFile keeps the filetime
+        if(srcTime && (dstTime >= srcTime) && (dstSize == srcSize)) {
+            batch->status[i] = VL__COPY_SKIPPED;
+            return;
+        }
+    }
+    bool ok = (batch->link != VL_LINK_NONE) && VL__LinkFile(batch->src.items[i], batch->dst.items[i], batch->link);
+    if(!ok) ok = VL__CopyFile(batch->src.items[i], batch->dst.items[i]);
+    batch->status[i] = ok ? VL__COPY_DONE : VL__COPY_FAILED;
+}
 
-    vl_file_paths children_tmp = {0};
-    string_builder src_sb = {0};
+// Same walk as VL_CopyDirectoryRecursively_Impl, but the files only get listed to copy them later
+static bool VL__CopyDirectoryCollect(const char *src, const char *dst, const char *ext, vl__copy_batch *batch)
+{
+    bool result = true;
 
-    file_type type = VL_GetFileType(parent);
+    file_type type = VL_GetFileType(src);
     if(type < 0) return false;
 
     switch(type) {
         case VL_FILE_DIRECTORY: {
-            if(!VL_ReadEntireDir(parent, &children_tmp)) VL_ReturnDefer(false);
-
-            for(size_t i = 0; i < children_tmp.count; ++i) {
-                if(strcmp(children_tmp.items[i], ".") == 0) continue;
-                if(strcmp(children_tmp.items[i], "..") == 0) continue;
-
-                src_sb.count = 0;
-                SbAppendCstr(&src_sb, parent);
-                SbAppendCstr(&src_sb, "/");
-                SbAppendCstr(&src_sb, children_tmp.items[i]);
-                SbAppendNull(&src_sb);
+            if(!MkdirIfNotExist(dst)) return false;
+        } break;
 
-                if(!VL_ReadDirectoryFilesRecursively(src_sb.items, children)) {
-                    VL_ReturnDefer(false);
-                }
+        case VL_FILE_REGULAR: {
+            if(ViewEndsWith(ViewFromCstr(src), ViewFromCstr(ext))) {
+                if(batch->link == VL_LINK_SYMBOLIC) src = VL__temp_AbsolutePath(src);
+                if(!src) return false;
+                DaAppend(&batch->src, src);
+                DaAppend(&batch->dst, dst);
             }
-        } break;
+        } return true;
 
-        case VL_FILE_REGULAR:
         case VL_FILE_SYMLINK: {
-            DaAppend(children, temp_strdup(parent));
-        } break;
+            VL_Log(VL_WARNING, "TODO: Copying symlinks is not supported yet");
+        } return true;
 
         case VL_FILE_OTHER: {
-            VL_Log(VL_ERROR, "Unsupported type of file %s", parent);
-            VL_ReturnDefer(false);
-        } break;
+            VL_Log(VL_ERROR, "Unsupported type of file %s", src);
+        } return false;
+
+        default: Assert(!"Unreachable");
+    }
 
-        default: Assert(!"unreachable");
+    // The walker strips trailing slashes from the root, everything after it is the relative path
+    size_t srcLen = strlen(src);
+    while(srcLen > 1 && (src[srcLen - 1] == '/' || src[srcLen - 1] == '\\')) srcLen--;
+    const char *srcAbs = NULL;
+    if(batch->link == VL_LINK_SYMBOLIC) {
+        srcAbs = VL__temp_AbsolutePath(src);
+        if(!srcAbs) return false;
+    }
+
+    vl_walk_dir walk;
+    vl_walk_entry entry;
+    if(!VL_WalkDir(&walk, src)) return false;
+    while(VL_WalkDirNext(&walk, &entry)) {
+        const char *rel = entry.path + srcLen;
+        const char *dstChild = temp_sprintf("%s%s", dst, rel);
+        switch(entry.type) {
+            case VL_FILE_DIRECTORY: {
+                if(!MkdirIfNotExist(dstChild)) VL_ReturnDefer(false);
+            } break;
+
+            case VL_FILE_REGULAR: {
+                if(!ViewEndsWith(ViewFromCstr(entry.name), ViewFromCstr(ext))) break;
+                DaAppend(&batch->src, srcAbs ? temp_sprintf("%s%s", srcAbs, rel) : entry.path);
+                DaAppend(&batch->dst, dstChild);
+            } break;
+
+            case VL_FILE_SYMLINK: {
+                VL_Log(VL_WARNING, "TODO: Copying symlinks is not supported yet");
+            } break;
+
+            case VL_FILE_OTHER: {
+                VL_Log(VL_ERROR, "Unsupported type of file %s", entry.path);
+                VL_ReturnDefer(false);
+            } break;
+
+            default: break; // removed while walking
+        }
     }
 
 defer:
-    DaFree(children_tmp);
-    DaFree(src_sb);
+    VL_WalkDirEnd(&walk);
     return result;
 }
 
-VLIBPROC bool VL_ReadEntireDir(const char *parent, vl_file_paths *children)
+VLIBPROC bool VL_CopyDirectoryRecursively_Opt(struct VL_CopyDirectoryRecursively_opts opt)
 {
-    bool result = true;
-    DIR *dir = NULL;
-    struct dirent *ent = NULL;
+    AssertMsg(opt.src != 0, "Invalid parameter: src directory is null");
+    if(opt.dst == 0) opt.dst = ".";
+    if(opt.ext == 0) opt.ext = "";
 
-    dir = opendir(parent);
-    if (dir == NULL) {
-        #ifdef _WIN32
-        VL_Log(VL_ERROR, "Could not open directory %s: %s", parent, Win32_ErrorMessage(GetLastError()));
-        #else
-        VL_Log(VL_ERROR, "Could not open directory %s: %s", parent, strerror(errno));
-        #endif // _WIN32
-        VL_ReturnDefer(false);
-    }
+    VL_Log(VL_ECHO, "copying %s/*%s -> %s", opt.src, opt.ext, opt.dst);
 
-    errno = 0;
-    ent = readdir(dir);
-    while (ent != NULL) {
-        DaAppend(children, temp_strdup(ent->d_name));
-        ent = readdir(dir);
+    size_t tempMark = temp_save();
+    vl__copy_batch batch = {.sync = opt.sync, .link = opt.link};
+    vl_log_level prevLogLevel = VL_MinimalLogLevel;
+    VL_MinimalLogLevel = VL_INFO;
+    u64 traceStart = VL_TraceClock();
+
+    bool ok = VL__CopyDirectoryCollect(opt.src, opt.dst, opt.ext, &batch);
+    size_t copied = 0;
+    if(ok && (batch.src.count > 0)) {
+        batch.status = (u8*)temp_alloc(batch.src.count, .Alignment = 1);
+        VL__ParallelFor(batch.src.count, (size_t)VL_GetCountProcs(), VL__CopyBatchProc, &batch);
+        for(size_t i = 0; i < batch.src.count; i++) {
+            if(batch.status[i] == VL__COPY_FAILED) ok = false;
+            if(batch.status[i] == VL__COPY_DONE) copied++;
+        }
     }
 
-    if (errno != 0) {
-        #ifdef _WIN32
-        VL_Log(VL_ERROR, "Could not read directory %s: %s", parent, Win32_ErrorMessage(GetLastError()));
-        #else
-        VL_Log(VL_ERROR, "Could not read directory %s: %s", parent, strerror(errno));
-        #endif // _WIN32
-        VL_ReturnDefer(false);
+    if(VL_Tracing) VL_TraceSpan("copydir", temp_sprintf("%s/*%s -> %s", opt.src, opt.ext, opt.dst), traceStart);
+    VL_MinimalLogLevel = prevLogLevel;
+    if(opt.sync) {
+        VL_Log(VL_ECHO, "%zu of %zu files were out of date in %s", copied, batch.src.count, opt.dst);
     }
 
-defer:
-    if (dir) closedir(dir);
-    return result;
+    DaFree(batch.src);
+    DaFree(batch.dst);
+    temp_rewind(tempMark);
+    return ok;
 }
 
-VLIBPROC bool VL_DeleteFile(const char *path)
+// Opens the directory in walk->path, nameOffset is where its name starts (relative to the directory on top of the stack)
+static bool VL__WalkDirPush(vl_walk_dir *walk, size_t nameOffset)
 {
-    VL_Log(VL_ECHO, "deleting %s", path);
-#ifdef _WIN32
-    if(!DeleteFileA(path)) {
-        VL_Log(VL_ERROR, "Could not delete file %s: %s", path, Win32_ErrorMessage(GetLastError()));
+    vl__walk_frame frame = {.pathLen = walk->path.count};
+    SbAppendNull(&walk->path);
+    walk->path.count--;
+#if OS_WINDOWS
+    (void)nameOffset;
+    SbAppendCstr(&walk->path, "\\*");
+    SbAppendNull(&walk->path);
+    frame.find = FindFirstFileExA(walk->path.items, FindExInfoBasic, &frame.data, FindExSearchNameMatch, 0, FIND_FIRST_EX_LARGE_FETCH);
+    walk->path.count = frame.pathLen;
+    if(frame.find == INVALID_HANDLE_VALUE) {
+        SbAppendNull(&walk->path);
+        VL_Log(VL_ERROR, "Could not read directory %s: %s", walk->path.items, Win32_ErrorMessage(GetLastError()));
+        walk->path.count--;
         return false;
     }
-    return true;
+    frame.hasData = true;
 #else
-    if(remove(path) < 0) {
-        VL_Log(VL_ERROR, "Could not delete file %s: %s", path, strerror(errno));
+    int parentFd = walk->stack.count ? dirfd(walk->stack.items[walk->stack.count - 1].dir) : AT_FDCWD;
+    int fd = openat(parentFd, walk->path.items + nameOffset, O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+    frame.dir = (fd < 0) ? 0 : fdopendir(fd);
+    if(!frame.dir) {
+        VL_Log(VL_ERROR, "Could not read directory %s: %s", walk->path.items, strerror(errno));
+        if(fd >= 0) close(fd);
         return false;
     }
+#endif
+    DaAppend(&walk->stack, frame);
     return true;
-#endif // _WIN32
 }
 
-VLIBPROC bool SbReadEntireFile(const char *path, string_builder *sb)
+static void VL__WalkDirPop(vl_walk_dir *walk)
 {
-    bool result = true;
-
-    FILE *f = fopen(path, "rb");
-    size_t new_count = 0;
-    long long m = 0;
-    if(f == NULL)                 VL_ReturnDefer(false);
-    if(fseek(f, 0, SEEK_END) < 0) VL_ReturnDefer(false);
-#ifndef _WIN32
-    m = ftell(f);
+    vl__walk_frame *frame = &walk->stack.items[--walk->stack.count];
+#if OS_WINDOWS
+    FindClose(frame->find);
 #else
-    m = _ftelli64(f);
+    closedir(frame->dir);
 #endif
-    if(m < 0)                     VL_ReturnDefer(false);
-    if(fseek(f, 0, SEEK_SET) < 0) VL_ReturnDefer(false);
+}
 
-    new_count = sb->count + m;
+VLIBPROC bool VL_WalkDir_Opt(vl_walk_dir *walk, struct VL_WalkDir_opts opt)
+{
+    AssertMsg(opt.root != 0, "Invalid parameter: root directory is null");
+    *walk = (vl_walk_dir){
+        .arena = opt.arena ? opt.arena : &ArenaTemp,
+        .ext = opt.ext,
+        .filesOnly = opt.filesOnly,
+    };
+    SbAppendCstr(&walk->path, opt.root);
+    while((walk->path.count > 1) && (walk->path.items[walk->path.count - 1] == '/' || walk->path.items[walk->path.count - 1] == '\\')) {
+        walk->path.count--;
+    }
+    if(!VL__WalkDirPush(walk, 0)) {
+        VL_WalkDirEnd(walk);
+        return false;
+    }
+    return true;
+}
+
+VLIBPROC bool VL_WalkDirNext(vl_walk_dir *walk, vl_walk_entry *entry)
+{
+    for(;;) {
+        if(walk->pendingDir) {
+            walk->pendingDir = false;
+            // NOTE: if it can't be opened it's logged and skipped, like find does
+            VL__WalkDirPush(walk, walk->stack.items[walk->stack.count - 1].pathLen + 1);
+        }
+        if(walk->stack.count == 0) return false;
+
+        vl__walk_frame *top = &walk->stack.items[walk->stack.count - 1];
+        walk->path.count = top->pathLen;
+        const char *name;
+        file_type type;
+#if OS_WINDOWS
+        if(!top->hasData && !FindNextFileA(top->find, &top->data)) {
+            VL__WalkDirPop(walk);
+            continue;
+        }
+        top->hasData = false;
+        name = top->data.cFileName;
+        DWORD attr = top->data.dwFileAttributes;
+        if(attr & FILE_ATTRIBUTE_REPARSE_POINT) type = VL_FILE_SYMLINK;
+        else if(attr & FILE_ATTRIBUTE_DIRECTORY) type = VL_FILE_DIRECTORY;
+        else type = VL_FILE_REGULAR;
+#else
+        struct dirent *d = readdir(top->dir);
+        if(!d) {
+            VL__WalkDirPop(walk);
+            continue;
+        }
+        name = d->d_name;
+        switch(d->d_type) {
+            case DT_REG: type = VL_FILE_REGULAR; break;
+            case DT_DIR: type = VL_FILE_DIRECTORY; break;
+            case DT_LNK: type = VL_FILE_SYMLINK; break;
+            case DT_UNKNOWN: {
+                // Some file systems don't fill d_type
+                struct stat st;
+                if(fstatat(dirfd(top->dir), name, &st, AT_SYMLINK_NOFOLLOW) < 0) type = VL_FILE_INVALID;
+                else if(S_ISREG(st.st_mode)) type = VL_FILE_REGULAR;
+                else if(S_ISDIR(st.st_mode)) type = VL_FILE_DIRECTORY;
+                else if(S_ISLNK(st.st_mode)) type = VL_FILE_SYMLINK;
+                else type = VL_FILE_OTHER;
+            } break;
+            default: type = VL_FILE_OTHER; break;
+        }
+#endif
+        if(!strcmp(name, ".") || !strcmp(name, "..")) continue;
+
+        DaAppend(&walk->path, '/');
+        SbAppendCstr(&walk->path, name);
+        if(type == VL_FILE_DIRECTORY) {
+            walk->pendingDir = true;
+            if(walk->filesOnly) continue;
+        } else if(walk->ext && !ViewEndsWith(ViewFromCstr(name), ViewFromCstr(walk->ext))) {
+            continue;
+        }
+
+        char *path = Arena_strndup(walk->arena, walk->path.items, walk->path.count);
+        Assert(path != NULL && "Buy more RAM lol!!");
+        *entry = (vl_walk_entry){
+            .path = path,
+            .name = path + top->pathLen + 1,
+            .type = type,
+            .depth = walk->stack.count - 1,
+        };
+        return true;
+    }
+}
+
+VLIBPROC void VL_WalkDirSkip(vl_walk_dir *walk)
+{
+    walk->pendingDir = false;
+}
+
+VLIBPROC void VL_WalkDirEnd(vl_walk_dir *walk)
+{
+    while(walk->stack.count > 0) VL__WalkDirPop(walk);
+    DaFree(walk->stack);
+    SbFree(walk->path);
+    *walk = (vl_walk_dir){0};
+}
+
+VLIBPROC bool VL_ReadDirectoryFilesRecursively(const char *parent, vl_file_paths *children)
+{
+    bool result = true;
+
+    file_type type = VL_GetFileType(parent);
+    if(type < 0) return false;
+
+    if(type == VL_FILE_OTHER) {
+        VL_Log(VL_ERROR, "Unsupported type of file %s", parent);
+        return false;
+    }
+    if(type != VL_FILE_DIRECTORY) {
+        DaAppend(children, temp_strdup(parent));
+        return true;
+    }
+
+    vl_walk_dir walk;
+    vl_walk_entry entry;
+    if(!VL_WalkDir(&walk, parent, .filesOnly = true)) return false;
+    while(VL_WalkDirNext(&walk, &entry)) {
+        if(entry.type == VL_FILE_INVALID) continue; // removed while walking
+        if(entry.type == VL_FILE_OTHER) {
+            VL_Log(VL_ERROR, "Unsupported type of file %s", entry.path);
+            VL_ReturnDefer(false);
+        }
+        DaAppend(children, entry.path);
+    }
+
+defer:
+    VL_WalkDirEnd(&walk);
+    return result;
+}
+
+VLIBPROC bool VL_ReadEntireDir(const char *parent, vl_file_paths *children)
+{
+    bool result = true;
+    DIR *dir = NULL;
+    struct dirent *ent = NULL;
+
+    dir = opendir(parent);
+    if (dir == NULL) {
+        #ifdef _WIN32
+        VL_Log(VL_ERROR, "Could not open directory %s: %s", parent, Win32_ErrorMessage(GetLastError()));
+        #else
+        VL_Log(VL_ERROR, "Could not open directory %s: %s", parent, strerror(errno));
+        #endif // _WIN32
+        VL_ReturnDefer(false);
+    }
+
+    errno = 0;
+    ent = readdir(dir);
+    while (ent != NULL) {
+        DaAppend(children, temp_strdup(ent->d_name));
+        ent = readdir(dir);
+    }
+
+    if (errno != 0) {
+        #ifdef _WIN32
+        VL_Log(VL_ERROR, "Could not read directory %s: %s", parent, Win32_ErrorMessage(GetLastError()));
+        #else
+        VL_Log(VL_ERROR, "Could not read directory %s: %s", parent, strerror(errno));
+        #endif // _WIN32
+        VL_ReturnDefer(false);
+    }
+
+defer:
+    if (dir) closedir(dir);
+    return result;
+}
+
+VLIBPROC bool VL_DeleteFile(const char *path)
+{
+    VL_Log(VL_ECHO, "deleting %s", path);
+#ifdef _WIN32
+    if(!DeleteFileA(path)) {
+        VL_Log(VL_ERROR, "Could not delete file %s: %s", path, Win32_ErrorMessage(GetLastError()));
+        return false;
+    }
+    return true;
+#else
+    if(remove(path) < 0) {
+        VL_Log(VL_ERROR, "Could not delete file %s: %s", path, strerror(errno));
+        return false;
+    }
+    return true;
+#endif // _WIN32
+}
+
+// NOTE: doesn't build paths or use the temporary storage, so it can run in multiple threads.
+// It keeps a directory open for every level it is in (an fd, a find handle on windows), so a tree deeper than the
+// open file limit can't be removed, and with .parallel every thread uses its own share of that limit
+#if OS_WINDOWS
+// path has the path of the directory without a null terminator, it gets the names of the children appended
+static bool VL__RemoveTreeWin32(string_builder *path)
+{
+    bool result = true;
+    size_t len = path->count;
+    SbAppendCstr(path, "\\*");
+    SbAppendNull(path);
+
+    WIN32_FIND_DATAA data;
+    HANDLE find = FindFirstFileExA(path->items, FindExInfoBasic, &data, FindExSearchNameMatch, 0, FIND_FIRST_EX_LARGE_FETCH);
+    if(find == INVALID_HANDLE_VALUE) {
+        path->count = len;
+        SbAppendNull(path);
+        VL_Log(VL_ERROR, "Could not read directory %s: %s", path->items, Win32_ErrorMessage(GetLastError()));
+        return false;
+    }
+
+    do {
+        if(!strcmp(data.cFileName, ".") || !strcmp(data.cFileName, "..")) continue;
+        path->count = len;
+        DaAppend(path, '\\');
+        SbAppendCstr(path, data.cFileName);
+        SbAppendNull(path);
+
+        if(data.dwFileAttributes & FILE_ATTRIBUTE_READONLY) {
+            SetFileAttributesA(path->items, data.dwFileAttributes & ~FILE_ATTRIBUTE_READONLY);
+        }
+        bool ok;
+        if(data.dwFileAttributes & FILE_ATTRIBUTE_DIRECTORY) {
+            // NOTE: symlinks and junctions to directories are removed, not what they point to
+            if(data.dwFileAttributes & FILE_ATTRIBUTE_REPARSE_POINT) ok = RemoveDirectoryA(path->items);
+            else {
+                path->count--;
+                if(!VL__RemoveTreeWin32(path)) result = false;
+                continue;
+            }
+        } else {
+            ok = DeleteFileA(path->items);
+        }
+        if(!ok) {
+            VL_Log(VL_ERROR, "Could not remove %s: %s", path->items, Win32_ErrorMessage(GetLastError()));
+            result = false;
+        }
+    } while(FindNextFileA(find, &data));
+    FindClose(find);
+
+    path->count = len;
+    SbAppendNull(path);
+    if(!RemoveDirectoryA(path->items)) {
+        VL_Log(VL_ERROR, "Could not remove directory %s: %s", path->items, Win32_ErrorMessage(GetLastError()));
+        result = false;
+    }
+    path->count = len;
+    return result;
+}
+#else
+// Removes name, which is relative to the directory dirFd
+static bool VL__RemoveTreeAt(int dirFd, const char *name, bool isDir)
+{
+    if(!isDir) {
+        if(unlinkat(dirFd, name, 0) == 0) return true;
+        // NOTE: readdir doesn't always know the type, linux says EISDIR for directories and mac EPERM
+        if((errno != EISDIR) && (errno != EPERM)) {
+            VL_Log(VL_ERROR, "Could not remove %s: %s", name, strerror(errno));
+            return false;
+        }
+    }
+
+    int fd = openat(dirFd, name, O_RDONLY | O_DIRECTORY | O_NOFOLLOW | O_CLOEXEC);
+    if(fd < 0) {
+        VL_Log(VL_ERROR, "Could not open directory %s: %s", name, strerror(errno));
+        return false;
+    }
+    DIR *dir = fdopendir(fd);
+    if(!dir) {
+        VL_Log(VL_ERROR, "Could not read directory %s: %s", name, strerror(errno));
+        close(fd);
+        return false;
+    }
+
+    bool result = true;
+    struct dirent *entry;
+    while((entry = readdir(dir))) {
+        if(!strcmp(entry->d_name, ".") || !strcmp(entry->d_name, "..")) continue;
+        if(!VL__RemoveTreeAt(fd, entry->d_name, entry->d_type == DT_DIR)) result = false;
+    }
+    closedir(dir); // closes fd
+
+    if(unlinkat(dirFd, name, AT_REMOVEDIR) < 0) {
+        VL_Log(VL_ERROR, "Could not remove directory %s: %s", name, strerror(errno));
+        result = false;
+    }
+    return result;
+}
+#endif
+
+typedef struct {
+    const char *root;
+#if !OS_WINDOWS
+    int rootFd;
+#endif
+    vl_file_paths children;
+    u8 *isDir;
+    u8 *failed;
+} vl__remove_tree;
+
+static void VL__RemoveTreeProc(void *data, size_t i)
+{
+    vl__remove_tree *tree = (vl__remove_tree*)data;
+#if OS_WINDOWS
+    string_builder path = {0};
+    SbAppendCstr(&path, tree->root);
+    DaAppend(&path, '\\');
+    SbAppendCstr(&path, tree->children.items[i]);
+    bool ok;
+    if(tree->isDir[i]) ok = VL__RemoveTreeWin32(&path);
+    else {
+        SbAppendNull(&path);
+        SetFileAttributesA(path.items, FILE_ATTRIBUTE_NORMAL);
+        ok = DeleteFileA(path.items);
+        if(!ok) VL_Log(VL_ERROR, "Could not remove %s: %s", path.items, Win32_ErrorMessage(GetLastError()));
+    }
+    SbFree(path);
+#else
+    bool ok = VL__RemoveTreeAt(tree->rootFd, tree->children.items[i], tree->isDir[i]);
+#endif
+    tree->failed[i] = !ok;
+}
+
+VLIBPROC bool VL_RemoveTree_Opt(struct VL_RemoveTree_opts opt)
+{
+    AssertMsg(opt.path != 0, "Invalid parameter: path is null");
+    file_type type = VL_GetFileType(opt.path);
+    if(type == VL_FILE_INVALID) return true; // already gone
+    VL_Log(VL_ECHO, "removing %s", opt.path);
+    u64 traceStart = VL_TraceClock();
+
+    bool result = true;
+    if(type != VL_FILE_DIRECTORY) {
+        result = VL_DeleteFile(opt.path);
+    } else if(!opt.parallel) {
+#if OS_WINDOWS
+        string_builder path = {0};
+        SbAppendCstr(&path, opt.path);
+        result = VL__RemoveTreeWin32(&path);
+        SbFree(path);
+#else
+        result = VL__RemoveTreeAt(AT_FDCWD, opt.path, true);
+#endif
+    } else {
+        // Every child of path gets removed in parallel, then path itself
+        size_t mark = temp_save();
+        vl__remove_tree tree = {.root = opt.path};
+        string_builder isDir = {0};
+#if OS_WINDOWS
+        WIN32_FIND_DATAA data;
+        HANDLE find = FindFirstFileExA(temp_sprintf("%s\\*", opt.path), FindExInfoBasic, &data, FindExSearchNameMatch, 0, FIND_FIRST_EX_LARGE_FETCH);
+        if(find == INVALID_HANDLE_VALUE) {
+            VL_Log(VL_ERROR, "Could not read directory %s: %s", opt.path, Win32_ErrorMessage(GetLastError()));
+            VL_ReturnDefer(false);
+        }
+        do {
+            if(!strcmp(data.cFileName, ".") || !strcmp(data.cFileName, "..")) continue;
+            DaAppend(&tree.children, temp_strdup(data.cFileName));
+            DaAppend(&isDir, (data.dwFileAttributes & FILE_ATTRIBUTE_DIRECTORY) &&
+                             !(data.dwFileAttributes & FILE_ATTRIBUTE_REPARSE_POINT));
+        } while(FindNextFileA(find, &data));
+        FindClose(find);
+#else
+        tree.rootFd = open(opt.path, O_RDONLY | O_DIRECTORY | O_NOFOLLOW | O_CLOEXEC);
+        DIR *dir = (tree.rootFd < 0) ? 0 : fdopendir(dup(tree.rootFd));
+        if(!dir) {
+            VL_Log(VL_ERROR, "Could not read directory %s: %s", opt.path, strerror(errno));
+            if(tree.rootFd >= 0) close(tree.rootFd);
+            VL_ReturnDefer(false);
+        }
+        struct dirent *entry;
+        while((entry = readdir(dir))) {
+            if(!strcmp(entry->d_name, ".") || !strcmp(entry->d_name, "..")) continue;
+            DaAppend(&tree.children, temp_strdup(entry->d_name));
+            DaAppend(&isDir, entry->d_type == DT_DIR);
+        }
+        closedir(dir);
+#endif
+
+        if(tree.children.count > 0) {
+            tree.isDir = (u8*)isDir.items;
+            tree.failed = (u8*)temp_alloc(tree.children.count, .Alignment = 1);
+            VL__ParallelFor(tree.children.count, (size_t)VL_GetCountProcs(), VL__RemoveTreeProc, &tree);
+            for(size_t i = 0; i < tree.children.count; i++) {
+                if(tree.failed[i]) result = false;
+            }
+        }
+        DaFree(tree.children);
+        SbFree(isDir);
+#if OS_WINDOWS
+        if(!RemoveDirectoryA(opt.path)) {
+            VL_Log(VL_ERROR, "Could not remove directory %s: %s", opt.path, Win32_ErrorMessage(GetLastError()));
+            result = false;
+        }
+#else
+        close(tree.rootFd);
+        if(rmdir(opt.path) < 0) {
+            VL_Log(VL_ERROR, "Could not remove directory %s: %s", opt.path, strerror(errno));
+            result = false;
+        }
+#endif
+    defer:
+        temp_rewind(mark);
+    }
+
+    if(VL_Tracing) VL_TraceSpan("remove", opt.path, traceStart);
+    return result;
+}
+
+VLIBPROC bool SbReadEntireFile(const char *path, string_builder *sb)
+{
+    bool result = true;
+
+    FILE *f = fopen(path, "rb");
+    size_t new_count = 0;
+    long long m = 0;
+    if(f == NULL)                 VL_ReturnDefer(false);
+    if(fseek(f, 0, SEEK_END) < 0) VL_ReturnDefer(false);
+#ifndef _WIN32
+    m = ftell(f);
+#else
+    m = _ftelli64(f);
+#endif
+    if(m < 0)                     VL_ReturnDefer(false);
+    if(fseek(f, 0, SEEK_SET) < 0) VL_ReturnDefer(false);
+
+    new_count = sb->count + m;
     if(new_count > sb->capacity) {
         sb->items = VL_DECLTYPE_CAST(sb->items)VL_REALLOC(sb->items, new_count);
         Assert(sb->items != NULL && "Buy more RAM lool!!");
@@ -1035,42 +2013,371 @@ VLIBPROC bool SbPadAlign(string_builder *sb, size_t size)
     return true;
 }
 
-VLIBPROC bool VL_ProcWait(vl_proc proc)
+vl_jobs VL_jobs = {0};
+
+VLIBPROC u64 VL_TraceClock(void)
 {
-    if(proc == VL_INVALID_PROC) return false;
+#if OS_WINDOWS
+    // NOTE: VL_GetNanos needs VL_Init on windows
+    LARGE_INTEGER frequency, counter;
+    QueryPerformanceFrequency(&frequency);
+    QueryPerformanceCounter(&counter);
+    return (u64)(counter.QuadPart/frequency.QuadPart)*VL_NANOS_PER_SEC +
+           (u64)(counter.QuadPart%frequency.QuadPart)*VL_NANOS_PER_SEC/(u64)frequency.QuadPart;
+#else
+    return VL_GetNanos();
+#endif
+}
 
-#ifdef _WIN32
-    DWORD result = WaitForSingleObject(
-                       proc,    // HANDLE hHandle,
-                       INFINITE // DWORD  dwMilliseconds
-                   );
+bool VL_Tracing = VL_BUILD_TRACE;
+vl_trace_events VL_traceEvents = {0};
 
-    if(result == WAIT_FAILED) {
-        VL_Log(VL_ERROR, "could not wait on child process: %s", Win32_ErrorMessage(GetLastError()));
-        return false;
-    }
+static void VL__TraceAdd(const char *category, const char *name, u64 start, u64 end)
+{
+    size_t size = strlen(name) + 1;
+    vl_trace_event event = {
+        .category = category,
+        .name = (char*)VL_REALLOC(0, size),
+        .start = start,
+        .end = end,
+    };
+    Assert(event.name != NULL && "Buy more RAM lol!!");
+    mem_copy_non_overlapping(event.name, name, size);
+    DaAppend(&VL_traceEvents, event);
+}
 
-    DWORD exit_status;
-    if(!GetExitCodeProcess(proc, &exit_status)) {
-        VL_Log(VL_ERROR, "could not get process exit code: %s", Win32_ErrorMessage(GetLastError()));
-        return false;
-    }
+VLIBPROC void VL_TraceSpan(const char *category, const char *name, u64 start)
+{
+    if(!VL_Tracing) return;
+    VL__TraceAdd(category, name, start, VL_TraceClock());
+}
 
-    if(exit_status != 0) {
-        VL_Log(VL_ERROR, "command exited with exit code %lu", exit_status);
-        return false;
+static int VL__TraceCompareDuration(const void *a, const void *b)
+{
+    const vl_trace_event *eventA = (const vl_trace_event*)a;
+    const vl_trace_event *eventB = (const vl_trace_event*)b;
+    u64 timeA = eventA->end - eventA->start;
+    u64 timeB = eventB->end - eventB->start;
+    // slowest first
+    return (timeA < timeB) - (timeA > timeB);
+}
+
+static int VL__TraceCompareStart(const void *a, const void *b)
+{
+    u64 startA = ((const vl_trace_event*)a)->start;
+    u64 startB = ((const vl_trace_event*)b)->start;
+    return (startA > startB) - (startA < startB);
+}
+
+#ifndef VL_BUILD_TRACE_SUMMARY_COUNT
+#define VL_BUILD_TRACE_SUMMARY_COUNT 10
+#endif // VL_BUILD_TRACE_SUMMARY_COUNT
+
+VLIBPROC void VL_PrintTraceSummary(void)
+{
+    if(VL_traceEvents.count == 0) return;
+    qsort(VL_traceEvents.items, VL_traceEvents.count, sizeof(vl_trace_event), VL__TraceCompareDuration);
+
+    u64 firstStart = VL_traceEvents.items[0].start;
+    u64 lastEnd = VL_traceEvents.items[0].end;
+    for(size_t i = 0; i < VL_traceEvents.count; i++) {
+        firstStart = min(firstStart, VL_traceEvents.items[i].start);
+        lastEnd = max(lastEnd, VL_traceEvents.items[i].end);
+    }
+    VL_Log(VL_INFO, "Build trace: %zu events in %.3fs of wall time", VL_traceEvents.count,
+           (double)(lastEnd - firstStart)/VL_NANOS_PER_SEC);
+
+    // NOTE: there are only a few categories, the ones that were already printed get skipped.
+    // The events are sorted, so the first one of each category is its slowest
+    for(size_t i = 0; i < VL_traceEvents.count; i++) {
+        const char *category = VL_traceEvents.items[i].category;
+        bool printed = false;
+        for(size_t j = 0; (j < i) && !printed; j++) {
+            printed = !strcmp(VL_traceEvents.items[j].category, category);
+        }
+        if(printed) continue;
+
+        size_t count = 0;
+        u64 total = 0;
+        for(size_t j = i; j < VL_traceEvents.count; j++) {
+            vl_trace_event *event = &VL_traceEvents.items[j];
+            if(strcmp(event->category, category)) continue;
+            count++;
+            total += event->end - event->start;
+        }
+        VL_Log(VL_INFO, "  %-8s %6zu events %10.2fms total %10.2fms slowest", category, count,
+               (double)total/1000000.0,
+               (double)(VL_traceEvents.items[i].end - VL_traceEvents.items[i].start)/1000000.0);
     }
 
-    CloseHandle(proc);
+    VL_Log(VL_INFO, "Slowest events:");
+    for(size_t i = 0; i < min(VL_traceEvents.count, (size_t)VL_BUILD_TRACE_SUMMARY_COUNT); i++) {
+        vl_trace_event *event = &VL_traceEvents.items[i];
+        VL_Log(VL_INFO, "%10.2fms  %-8s %s", (double)(event->end - event->start)/1000000.0,
+               event->category, event->name);
+    }
+}
 
-    return true;
-#else
-    for(;;) {
-        int wstatus = 0;
-        if(waitpid(proc, &wstatus, 0) < 0) {
-            VL_Log(VL_ERROR, "could not wait on command (pid %d): %s", proc, strerror(errno));
-            return false;
+static void VL__SbAppendJsonString(string_builder *sb, const char *s)
+{
+    DaAppend(sb, '"');
+    for(; *s; s++) {
+        if((*s == '"') || (*s == '\\')) {
+            DaAppend(sb, '\\');
+            DaAppend(sb, *s);
+        } else if((u8)*s < 0x20) {
+            SbAppendf(sb, "\\u%04x", (u8)*s);
+        } else {
+            DaAppend(sb, *s);
         }
+    }
+    DaAppend(sb, '"');
+}
+
+VLIBPROC bool VL_WriteTrace(const char *path)
+{
+    string_builder sb = {0};
+    struct { u64 *items; size_t count; size_t capacity; } rowEnds = {0};
+
+    qsort(VL_traceEvents.items, VL_traceEvents.count, sizeof(vl_trace_event), VL__TraceCompareStart);
+    u64 firstStart = VL_traceEvents.count ? VL_traceEvents.items[0].start : 0;
+
+    SbAppendCstr(&sb, "{\"traceEvents\":[\n");
+    SbAppendCstr(&sb, "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":0,\"tid\":0,\"args\":{\"name\":\"build\"}}");
+    for(size_t i = 0; i < VL_traceEvents.count; i++) {
+        vl_trace_event *event = &VL_traceEvents.items[i];
+
+        // NOTE: what the build does by itself nests on row 0, each command goes on the first row
+        // that is free when it starts, so there are as many rows as commands that ran at the same time
+        size_t row = 0;
+        if(!strcmp(event->category, "cmd")) {
+            for(row = 1; row <= rowEnds.count; row++) {
+                if(rowEnds.items[row - 1] <= event->start) break;
+            }
+            if(row > rowEnds.count) {
+                DaAppend(&rowEnds, 0);
+                SbAppendf(&sb, ",\n{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":0,\"tid\":%zu,"
+                          "\"args\":{\"name\":\"commands %zu\"}}", row, row);
+            }
+            rowEnds.items[row - 1] = event->end;
+        }
+
+        SbAppendCstr(&sb, ",\n{\"name\":");
+        VL__SbAppendJsonString(&sb, event->name);
+        SbAppendCstr(&sb, ",\"cat\":");
+        VL__SbAppendJsonString(&sb, event->category);
+        SbAppendf(&sb, ",\"ph\":\"X\",\"ts\":%.3f,\"dur\":%.3f,\"pid\":0,\"tid\":%zu}",
+                  (double)(event->start - firstStart)/1000.0, (double)(event->end - event->start)/1000.0, row);
+    }
+    SbAppendCstr(&sb, "\n]}\n");
+
+    bool result = WriteEntireFile(path, sb.items, sb.count);
+    if(result) {
+        VL_Log(VL_INFO, "Wrote the build trace to %s", path);
+    } else {
+        VL_Log(VL_ERROR, "Could not write the build trace to %s", path);
+    }
+    SbFree(sb);
+    DaFree(rowEnds);
+    return result;
+}
+
+static vl_job *VL__JobFind(vl_proc proc)
+{
+    // NOTE: finished jobs are skipped, their pid/handle could belong to another process by now
+    for(size_t i = VL_jobs.count; i > 0; i--) {
+        vl_job *job = &VL_jobs.items[i - 1];
+        if((job->proc == proc) && (job->end == 0)) return job;
+    }
+    return 0;
+}
+
+// Reads the captured output that is available without blocking, false once every writer closed the pipe
+static bool VL__JobReadOutput(vl_job *job)
+{
+    char buf[4096];
+    for(;;) {
+#if OS_WINDOWS
+        DWORD available = 0;
+        if(!PeekNamedPipe(job->output, 0, 0, 0, &available, 0)) return false;
+        if(available == 0) return true;
+        DWORD bytesRead = 0;
+        if(!ReadFile(job->output, buf, min(available, (DWORD)sizeof(buf)), &bytesRead, 0) || (bytesRead == 0)) {
+            return false;
+        }
+#else
+        struct pollfd pollfd = {.fd = job->output, .events = POLLIN};
+        if(poll(&pollfd, 1, 0) <= 0) return true;
+        ssize_t bytesRead = read(job->output, buf, sizeof(buf));
+        if((bytesRead < 0) && (errno == EINTR)) continue;
+        if(bytesRead <= 0) return false;
+#endif
+        SbAppendBuf(&job->text, buf, (size_t)bytesRead);
+    }
+}
+
+// Reads the captured output of the jobs in procs, returns true if some of them are still capturing
+static bool VL__JobsReadOutput(vl_procs procs)
+{
+    bool capturing = false;
+    for(size_t i = 0; i < procs.count; i++) {
+        vl_job *job = VL__JobFind(procs.items[i]);
+        if(!job || (job->output == VL_INVALID_FD)) continue;
+        if(VL__JobReadOutput(job)) {
+            capturing = true;
+        } else {
+            VL_FileClose(job->output);
+            job->output = VL_INVALID_FD;
+        }
+    }
+    return capturing;
+}
+
+// Called when the process of a job gets reaped: records its end time and prints everything it wrote at once
+static void VL__JobFinished(vl_proc proc)
+{
+    vl_job *job = VL__JobFind(proc);
+    if(!job) return;
+    job->end = VL_TraceClock();
+    if(VL_Tracing) VL__TraceAdd("cmd", job->name, job->start, job->end);
+
+    if(job->output != VL_INVALID_FD) {
+        // NOTE: the process is gone, anything it wrote is already in the pipe
+        VL__JobReadOutput(job);
+        VL_FileClose(job->output);
+        job->output = VL_INVALID_FD;
+    }
+#if OS_LINUX
+    if(job->pidfd >= 0) {
+        close(job->pidfd);
+        job->pidfd = -1;
+    }
+#endif
+
+    if(job->text.count > 0) {
+        if(job->text.items[job->text.count - 1] != '\n') DaAppend(&job->text, '\n');
+        fwrite(job->text.items, 1, job->text.count, stderr);
+        fflush(stderr);
+    }
+    SbFree(job->text);
+    job->text = (string_builder){0};
+}
+
+static int VL__JobCompareTime(const void *a, const void *b)
+{
+    const vl_job *jobA = (const vl_job*)a;
+    const vl_job *jobB = (const vl_job*)b;
+    u64 timeA = jobA->end - jobA->start;
+    u64 timeB = jobB->end - jobB->start;
+    // slowest first
+    return (timeA < timeB) - (timeA > timeB);
+}
+
+static void VL__JobsForgetOldest(void)
+{
+    size_t finishedCount = 0;
+    for(size_t i = 0; i < VL_jobs.count; i++) {
+        if(VL_jobs.items[i].end != 0) finishedCount++;
+    }
+    if(finishedCount < VL_MAX_FINISHED_JOBS) return;
+
+    // NOTE: jobs get appended as they start, so the finished ones at the front are the oldest
+    size_t forgetCount = finishedCount - VL_MAX_FINISHED_JOBS/2;
+    size_t keptCount = 0;
+    for(size_t i = 0; i < VL_jobs.count; i++) {
+        vl_job job = VL_jobs.items[i];
+        if((job.end != 0) && (forgetCount > 0)) {
+            VL_FREE(job.name);
+            forgetCount--;
+        } else {
+            VL_jobs.items[keptCount++] = job;
+        }
+    }
+    VL_jobs.count = keptCount;
+}
+
+VLIBPROC void VL_PrintJobSummary(void)
+{
+    // NOTE: the jobs that are still running are kept for the next summary
+    size_t finishedCount = 0;
+    for(size_t i = 0; i < VL_jobs.count; i++) {
+        if(VL_jobs.items[i].end == 0) continue;
+        vl_job finished = VL_jobs.items[i];
+        VL_jobs.items[i] = VL_jobs.items[finishedCount];
+        VL_jobs.items[finishedCount++] = finished;
+    }
+    if(finishedCount == 0) return;
+
+    qsort(VL_jobs.items, finishedCount, sizeof(vl_job), VL__JobCompareTime);
+
+    u64 firstStart = VL_jobs.items[0].start;
+    u64 lastEnd = VL_jobs.items[0].end;
+    u64 total = 0;
+    for(size_t i = 0; i < finishedCount; i++) {
+        vl_job *job = &VL_jobs.items[i];
+        firstStart = min(firstStart, job->start);
+        lastEnd = max(lastEnd, job->end);
+        total += job->end - job->start;
+    }
+
+    VL_Log(VL_INFO, "%zu commands took %.3fs (%.3fs of wall time):", finishedCount,
+           (double)total/VL_NANOS_PER_SEC, (double)(lastEnd - firstStart)/VL_NANOS_PER_SEC);
+    for(size_t i = 0; i < finishedCount; i++) {
+        vl_job *job = &VL_jobs.items[i];
+        VL_Log(VL_INFO, "%10.2fms  %s", (double)(job->end - job->start)/1000000.0, job->name);
+        VL_FREE(job->name);
+    }
+
+    VL_jobs.count -= finishedCount;
+    mem_copy(VL_jobs.items, VL_jobs.items + finishedCount, VL_jobs.count*sizeof(vl_job));
+}
+
+VLIBPROC bool VL_ProcWait(vl_proc proc)
+{
+    if(proc == VL_INVALID_PROC) return false;
+
+    vl_job *job = VL__JobFind(proc);
+    if(job && (job->output != VL_INVALID_FD)) {
+        // NOTE: the captured output has to be read while waiting, the process could block on a full pipe
+        bool ok;
+        vl_procs procs = {&proc, 1, 1};
+        return (VL_ProcsWaitAny(procs, -1, &ok) == 0) && ok;
+    }
+
+#ifdef _WIN32
+    DWORD result = WaitForSingleObject(
+                       proc,    // HANDLE hHandle,
+                       INFINITE // DWORD  dwMilliseconds
+                   );
+
+    if(result == WAIT_FAILED) {
+        VL_Log(VL_ERROR, "could not wait on child process: %s", Win32_ErrorMessage(GetLastError()));
+        return false;
+    }
+    VL__JobFinished(proc);
+
+    DWORD exit_status;
+    if(!GetExitCodeProcess(proc, &exit_status)) {
+        VL_Log(VL_ERROR, "could not get process exit code: %s", Win32_ErrorMessage(GetLastError()));
+        return false;
+    }
+
+    if(exit_status != 0) {
+        VL_Log(VL_ERROR, "command exited with exit code %lu", exit_status);
+        return false;
+    }
+
+    CloseHandle(proc);
+
+    return true;
+#else
+    for(;;) {
+        int wstatus = 0;
+        if(waitpid(proc, &wstatus, 0) < 0) {
+            VL_Log(VL_ERROR, "could not wait on command (pid %d): %s", proc, strerror(errno));
+            return false;
+        }
+        VL__JobFinished(proc);
 
         if(WIFEXITED(wstatus)) {
             int exit_status = WEXITSTATUS(wstatus);
@@ -1110,6 +2417,7 @@ VLIBPROC int VL__ProcWaitAsync(vl_proc proc, int ms)
         VL_Log(VL_ERROR, "could not wait on child process: %s", Win32_ErrorMessage(GetLastError()));
         return -1;
     }
+    VL__JobFinished(proc);
 
     DWORD exit_status;
     if(!GetExitCodeProcess(proc, &exit_status)) {
@@ -1139,251 +2447,1122 @@ VLIBPROC int VL__ProcWaitAsync(vl_proc proc, int ms)
         return -1;
     }
 
-    if(pid == 0) {
-        nanosleep(&duration, NULL);
-        return 0;
+    if(pid == 0) {
+        nanosleep(&duration, NULL);
+        return 0;
+    }
+    VL__JobFinished(proc);
+
+    if(WIFEXITED(wstatus)) {
+        int exit_status = WEXITSTATUS(wstatus);
+        if(exit_status != 0) {
+            VL_Log(VL_ERROR, "command exited with exit code %d", exit_status);
+            return -1;
+        }
+
+        return 1;
+    }
+
+    if(WIFSIGNALED(wstatus)) {
+        VL_Log(VL_ERROR, "command process was terminated by signal %d", WTERMSIG(wstatus));
+        return -1;
+    }
+
+    nanosleep(&duration, NULL);
+    return 0;
+#endif
+}
+
+#if OS_WINDOWS
+// Gets the exit code of a finished process and closes its handle
+static bool VL__ProcExitedOk(vl_proc proc)
+{
+    bool result = true;
+    VL__JobFinished(proc);
+    DWORD exit_status;
+    if(!GetExitCodeProcess(proc, &exit_status)) {
+        VL_Log(VL_ERROR, "could not get process exit code: %s", Win32_ErrorMessage(GetLastError()));
+        result = false;
+    } else if(exit_status != 0) {
+        VL_Log(VL_ERROR, "command exited with exit code %lu", exit_status);
+        result = false;
+    }
+
+    CloseHandle(proc);
+    return result;
+}
+#else
+static bool VL__ProcExitedOk(int wstatus)
+{
+    if(WIFEXITED(wstatus)) {
+        int exit_status = WEXITSTATUS(wstatus);
+        if(exit_status != 0) {
+            VL_Log(VL_ERROR, "command exited with exit code %d", exit_status);
+            return false;
+        }
+        return true;
+    }
+
+    if(WIFSIGNALED(wstatus)) {
+        VL_Log(VL_ERROR, "command process was terminated by signal %d", WTERMSIG(wstatus));
+    }
+    return false;
+}
+
+// Reaps the first process in procs that has finished, -1 if all of them are still running
+static int VL__ProcsReapAny(vl_procs procs, bool *ok)
+{
+    for(size_t i = 0; i < procs.count; i++) {
+        int wstatus = 0;
+        pid_t pid = waitpid(procs.items[i], &wstatus, WNOHANG);
+        if(pid < 0) {
+            // NOTE: the process can't be waited on anymore either way, so it's still reported as finished
+            VL_Log(VL_ERROR, "could not wait on command (pid %d): %s", procs.items[i], strerror(errno));
+            VL__JobFinished(procs.items[i]);
+            *ok = false;
+            return (int)i;
+        }
+        if(pid == procs.items[i]) {
+            VL__JobFinished(procs.items[i]);
+            *ok = VL__ProcExitedOk(wstatus);
+            return (int)i;
+        }
+    }
+    return -1;
+}
+
+// Sleeps until some process in procs might have finished, wrote captured output, or ms have passed (ms < 0 is forever).
+// NOTE: waitpid(-1) can't be used here, it would also reap children that are not in procs
+static void VL__ProcsSleep(vl_procs procs, int ms)
+{
+    if(!VL__JobsReadOutput(procs) && (ms == 0)) return;
+
+    // NOTE: Headers older than linux 5.3 don't have SYS_pidfd_open, those poll like below
+#if OS_LINUX && defined(SYS_pidfd_open)
+    size_t tempMark = temp_save();
+    struct pollfd *fds = PushArray(&ArenaTemp, 2*procs.count, struct pollfd);
+    size_t fdCount = 0;
+    // pidfds need linux 5.3, they could also run out. Processes not started by CmdRun don't have one either
+    bool waited = true;
+    for(size_t i = 0; i < procs.count; i++) {
+        vl_job *job = VL__JobFind(procs.items[i]);
+        if(!job || (job->pidfd < 0)) {
+            waited = false;
+            break;
+        }
+        fds[fdCount++] = (struct pollfd){.fd = job->pidfd, .events = POLLIN};
+        if(job->output != VL_INVALID_FD) fds[fdCount++] = (struct pollfd){.fd = job->output, .events = POLLIN};
+    }
+    if(waited) poll(fds, fdCount, ms);
+    temp_rewind(tempMark);
+    if(waited) {
+        VL__JobsReadOutput(procs);
+        return;
+    }
+#elif OS_MAC
+    int kq = kqueue();
+    if(kq >= 0) {
+        size_t tempMark = temp_save();
+        struct kevent *changes = PushArray(&ArenaTemp, 2*procs.count, struct kevent);
+        int count = 0;
+        for(size_t i = 0; i < procs.count; i++) {
+            EV_SET(&changes[count++], procs.items[i], EVFILT_PROC, EV_ADD|EV_ONESHOT, NOTE_EXIT, 0, 0);
+            vl_job *job = VL__JobFind(procs.items[i]);
+            if(job && (job->output != VL_INVALID_FD)) {
+                EV_SET(&changes[count++], job->output, EVFILT_READ, EV_ADD|EV_ONESHOT, 0, 0, 0);
+            }
+        }
+
+        // A process that exited before being added shows up as an EV_ERROR event, which also wakes this up
+        struct kevent event;
+        struct timespec timeout = {.tv_sec = ms/1000, .tv_nsec = (ms%1000)*1000*1000};
+        int ret = kevent(kq, changes, count, &event, 1, (ms < 0) ? NULL : &timeout);
+        close(kq);
+        temp_rewind(tempMark);
+        if(ret >= 0) {
+            VL__JobsReadOutput(procs);
+            return;
+        }
+    }
+#endif
+
+    // No way to block on the processes, poll them every millisecond instead
+    struct timespec duration = {.tv_sec = 0, .tv_nsec = 1000*1000};
+    if(ms == 0) return;
+    nanosleep(&duration, NULL);
+}
+#endif
+
+VLIBPROC int VL_ProcsWaitAny(vl_procs procs, int ms, bool *ok)
+{
+    bool okDummy;
+    if(!ok) ok = &okDummy;
+    *ok = true;
+    if(procs.count == 0) return -1;
+
+#if OS_WINDOWS
+    ULONGLONG start = GetTickCount64();
+    for(;;) {
+        // WaitForMultipleObjects can only take MAXIMUM_WAIT_OBJECTS handles, if there are more they have to be polled.
+        // They also have to be polled while there's captured output to read, pipes can't be waited on
+        bool polling = VL__JobsReadOutput(procs) || (procs.count > MAXIMUM_WAIT_OBJECTS);
+        DWORD timeout = 0;
+        if(!polling) {
+            timeout = (ms < 0) ? INFINITE : (DWORD)ms;
+        }
+
+        for(size_t base = 0; base < procs.count; base += MAXIMUM_WAIT_OBJECTS) {
+            DWORD count = (DWORD)min(procs.count - base, MAXIMUM_WAIT_OBJECTS);
+            DWORD result = WaitForMultipleObjects(count, procs.items + base, FALSE, timeout);
+            if(result == WAIT_FAILED) {
+                VL_Log(VL_ERROR, "could not wait on child processes: %s", Win32_ErrorMessage(GetLastError()));
+                *ok = false;
+                return -1;
+            }
+
+            if(result < WAIT_OBJECT_0 + count) {
+                size_t i = base + (result - WAIT_OBJECT_0);
+                *ok = VL__ProcExitedOk(procs.items[i]);
+                return (int)i;
+            }
+        }
+
+        if(!polling) return -1;
+        if((ms >= 0) && (GetTickCount64() - start >= (ULONGLONG)ms)) return -1;
+        Sleep(1);
+    }
+#else
+    u64 deadline = (ms >= 0) ? VL_GetNanos() + (u64)ms*1000*1000 : 0;
+    for(;;) {
+        int index = VL__ProcsReapAny(procs, ok);
+        if(index >= 0) return index;
+
+        int timeout = -1;
+        if(ms >= 0) {
+            u64 now = VL_GetNanos();
+            if(now >= deadline) return -1;
+            timeout = (int)((deadline - now + 999999)/(1000*1000));
+        }
+        VL__ProcsSleep(procs, timeout);
+    }
+#endif
+}
+
+// Wait until all the processes have finished
+VLIBPROC bool VL_ProcsWait(vl_procs procs)
+{
+    bool ok = true;
+    // NOTE: the processes get reaped in the order they finish, so their output is printed as soon as possible.
+    // The ones left to wait on are a copy so the caller's items keep their order
+    size_t tempMark = temp_save();
+    vl_procs left = procs;
+    left.items = PushArray(&ArenaTemp, procs.count, vl_proc);
+    mem_copy(left.items, procs.items, procs.count*sizeof(vl_proc));
+    while(left.count > 0) {
+        bool procOk;
+        int i = VL_ProcsWaitAny(left, -1, &procOk);
+        if(i < 0) {
+            // They can't be waited on together, the rest still get reaped one by one so none are left behind
+            for(size_t j = 0; j < left.count; j++) VL_ProcWait(left.items[j]);
+            ok = false;
+            break;
+        }
+        ok = procOk && ok;
+        left.items[i] = left.items[--left.count];
+    }
+    temp_rewind(tempMark);
+    return ok;
+}
+
+// Wait until all the processes have finished and empty the procs array.
+VLIBPROC bool VL_ProcsFlush(vl_procs *procs)
+{
+    bool ok = VL_ProcsWait(*procs);
+    procs->count = 0;
+    return ok;
+}
+
+VLIBPROC bool VL_WatchSleep(vl_procs procs, int ms)
+{
+    if(procs.count > 0) return VL_ProcsWaitAny(procs, ms, 0) >= 0;
+#if OS_WINDOWS
+    Sleep((DWORD)ms);
+#else
+    struct timespec duration = {.tv_sec = ms/1000, .tv_nsec = (long)(ms%1000)*1000*1000};
+    nanosleep(&duration, NULL);
+#endif
+    return false;
+}
+
+#if !defined(VICLIB_NO_FILE_WATCH)
+VLIBPROC u64 VL_WatchDirectory(vl_file_watch *watch, const char *directory, const char *ext)
+{
+    u64 bits = 0;
+    vl_walk_dir walk;
+    vl_walk_entry entry;
+    if(VL_WalkDir(&walk, directory, .ext = ext, .filesOnly = true)) {
+        while(VL_WalkDirNext(&walk, &entry)) {
+            u64 bit = VL_WatchFile(watch, entry.path);
+            if(!bit) VL_Log(VL_WARNING, "Could not watch %s", entry.path);
+            bits |= bit;
+        }
+        VL_WalkDirEnd(&walk);
+    }
+    return bits;
+}
+#endif
+
+VLIBPROC void VL_CmdRender(vl_cmd cmd, string_builder *render)
+{
+    for(size_t i = 0; i < cmd.count; ++i) {
+        const char *arg = cmd.items[i];
+        if(arg == NULL) break;
+        if(i > 0) SbAppendCstr(render, " ");
+        if(!strchr(arg, ' ')) {
+            SbAppendCstr(render, arg);
+        } else {
+            DaAppend(render, '\'');
+            SbAppendCstr(render, arg);
+            DaAppend(render, '\'');
+        }
+    }
+}
+
+VLIBPROC bool CmdRun_Opt(vl_cmd_opts opt)
+{
+    bool result = true;
+    vl_fd fdin = VL_INVALID_FD;
+    vl_fd fdout = VL_INVALID_FD;
+    vl_fd fderr = VL_INVALID_FD;
+    vl_proc proc = VL_INVALID_PROC;
+    vl_fd *optFdin = 0;
+    vl_fd *optFdout = 0;
+    vl_fd *optFderr = 0;
+    vl_fd captureRead = VL_INVALID_FD;
+    vl_fd captureWrite = VL_INVALID_FD;
+
+    size_t max_procs = opt.maxProcs > 0 ? opt.maxProcs : (size_t) VL_GetCountProcs() + 1;
+
+    if(opt.async && max_procs > 0) {
+        while(opt.async->count >= max_procs) {
+            bool ok;
+            int i = VL_ProcsWaitAny(*opt.async, -1, &ok);
+            if(i >= 0) DaRemoveUnordered(opt.async, i);
+            if(!ok) VL_ReturnDefer(false);
+        }
+    }
+
+    if(opt.stdinPath) {
+        fdin = VL_FopenForRead(opt.stdinPath);
+        if(fdin == VL_INVALID_FD) VL_ReturnDefer(false);
+        optFdin = &fdin;
+    }
+    if(opt.stdoutPath) {
+        fdout = VL_FopenForWrite(opt.stdoutPath);
+        if(fdout == VL_INVALID_FD) VL_ReturnDefer(false);
+        optFdout = &fdout;
+    }
+    if(opt.stderrPath) {
+        fderr = VL_FopenForWrite(opt.stderrPath);
+        if(fderr == VL_INVALID_FD) VL_ReturnDefer(false);
+        optFderr = &fderr;
+    }
+    if(opt.captureOutput) {
+        if(!VL_Pipe(&captureRead, &captureWrite)) {
+            VL_Log(VL_ERROR, "Could not create pipe to capture the output of %s", opt.cmd->items[0]);
+            captureRead = VL_INVALID_FD;
+            VL_ReturnDefer(false);
+        }
+        if(!optFdout) optFdout = &captureWrite;
+        if(!optFderr) optFderr = &captureWrite;
+    }
+
+    vl_job job = {
+        .output = captureRead,
+#if OS_LINUX
+        .pidfd = -1,
+#endif
+        .start = VL_TraceClock(),
+    };
+    proc = VL_CmdStartProcessIn(*opt.cmd, optFdin, optFdout, optFderr, true, opt.workingDir);
+    if(proc == VL_INVALID_PROC) VL_ReturnDefer(false);
+
+    string_builder name = {0};
+    VL_CmdRender(*opt.cmd, &name);
+    SbAppendNull(&name);
+    job.proc = proc;
+    job.name = name.items;
+#if OS_LINUX && defined(SYS_pidfd_open)
+    // NOTE: opened once here instead of on every wait, it's closed when the process gets reaped
+    job.pidfd = (int)syscall(SYS_pidfd_open, proc, 0);
+#endif
+    VL__JobsForgetOldest();
+    DaAppend(&VL_jobs, job);
+    captureRead = VL_INVALID_FD; // the job owns it now
+
+    // NOTE: the child has its own copy, the pipe only gets closed once every writer is gone
+    if(captureWrite != VL_INVALID_FD) {
+        VL_FileClose(captureWrite);
+        captureWrite = VL_INVALID_FD;
+    }
+
+    if(opt.async) {
+        DaAppend(opt.async, proc);
+    } else {
+        if(!VL_ProcWait(proc)) VL_ReturnDefer(false);
+    }
+
+defer:
+    if(fdin != VL_INVALID_FD)  VL_FileClose(fdin);
+    if(fdout != VL_INVALID_FD) VL_FileClose(fdout);
+    if(fderr != VL_INVALID_FD) VL_FileClose(fderr);
+    if(captureRead != VL_INVALID_FD)  VL_FileClose(captureRead);
+    if(captureWrite != VL_INVALID_FD) VL_FileClose(captureWrite);
+    opt.cmd->count = 0;
+#if OS_WINDOWS
+    opt.cmd->msvc_linkflags = 0;
+#endif
+    return result;
+}
+
+VLIBPROC int VL_GetCountProcs(void)
+{
+    static int count = 0;
+    if(count != 0) return count;
+    const char *jobs = getenv("VL_BUILD_JOBS");
+    if(jobs && (atoi(jobs) > 0)) {
+        count = atoi(jobs);
+        return count;
+    }
+#ifdef _WIN32
+    SYSTEM_INFO siSysInfo;
+    GetSystemInfo(&siSysInfo);
+    count = siSysInfo.dwNumberOfProcessors;
+#else
+    count = sysconf(_SC_NPROCESSORS_ONLN);
+#endif
+    return count;
+}
+
+VLIBPROC char *temp_sprintf(const char *fmt, ...)
+{
+    va_list args;
+    va_start(args, fmt);
+    int n = vsnprintf(NULL, 0, fmt, args);
+    va_end(args);
+
+    Assert(n >= 0);
+    char *result = (char*)ArenaPushSize(&ArenaTemp, n + 1, .Alignment = 1);
+    va_start(args, fmt);
+    vsnprintf(result, n + 1, fmt, args);
+    va_end(args);
+
+    return result;
+}
+
+VLIBPROC const char *VL_PathName(const char *path)
+{
+#ifdef _WIN32
+    const char *p1 = strrchr(path, '/');
+    const char *p2 = strrchr(path, '\\');
+    const char *p = (p1 > p2)? p1 : p2;  // NULL is ignored if the other search is successful
+    return p ? p + 1 : path;
+#else
+    const char *p = strrchr(path, '/');
+    return p ? p + 1 : path;
+#endif // _WIN32
+}
+
+VLIBPROC bool VL_Rename(const char *old_path, const char *new_path)
+{
+    VL_Log(VL_ECHO, "renaming %s -> %s", old_path, new_path);
+#ifdef _WIN32
+    if(!MoveFileEx(old_path, new_path, MOVEFILE_REPLACE_EXISTING)) {
+        VL_Log(VL_ERROR, "could not rename %s to %s: %s", old_path, new_path, Win32_ErrorMessage(GetLastError()));
+        return false;
+    }
+#else
+    if(rename(old_path, new_path) < 0) {
+        VL_Log(VL_ERROR, "could not rename %s to %s: %s", old_path, new_path, strerror(errno));
+        return false;
+    }
+#endif // _WIN32
+    return true;
+}
+
+VLIBPROC bool VL_GetLastWriteTime(const char *file, u64 *writeTime)
+{
+    bool result = true;
+    if(!GetLastWriteTime(file, writeTime)) {
+#ifdef _WIN32
+        VL_Log(VL_ERROR, "Could not get filetime of '%s': %s", file, Win32_ErrorMessage(GetLastError()));
+#else
+        VL_Log(VL_ERROR, "Could not get filetime of '%s': %s", file, strerror(errno));
+#endif
+        result = false;
+    }
+    return result;
+}
+
+static int VL__ContentHashCheck(view output, u64 outputFileTime, const view *inputs, size_t count, int result);
+static u64 VL__FileTime(const char *path);
+
+VLIBPROC int VL_NeedsRebuild_Impl(const char *output_path, const char **input_paths, size_t input_paths_count)
+{
+    u64 outputFileTime;
+    if(!GetLastWriteTime(output_path, &outputFileTime)) return 1;
+
+    int result = 0;
+    for(size_t i = 0; i < input_paths_count; ++i) {
+        const char *input_path = input_paths[i];
+        u64 inputFileTime;
+        if(!VL_GetLastWriteTime(input_path, &inputFileTime)) return -1;
+
+        // NOTE: if even a single input_path is fresher than output_path that's 100% rebuild
+        if(inputFileTime > outputFileTime) {
+            result = 1;
+            break;
+        }
+    }
+
+    if(VL_ContentHashRebuilds) {
+        size_t tempMark = temp_save();
+        view *inputs = (view*)temp_alloc(input_paths_count*sizeof(view), .Alignment = 8);
+        for(size_t i = 0; i < input_paths_count; ++i) inputs[i] = ViewFromCstr(input_paths[i]);
+        result = VL__ContentHashCheck(ViewFromCstr(output_path), VL__FileTime(output_path),
+                                      inputs, input_paths_count, result);
+        temp_rewind(tempMark);
+    }
+
+    return result;
+}
+
+VLIBPROC int VL_NeedsRebuildDepfile(const char *output_path, const char *input_path, const char *depfile)
+{
+    int result = 0;
+    size_t tempMark = temp_save();
+    string_builder sb = {0};
+    vl_file_paths inputs = {0};
+
+    if(!VL_FileExists(depfile) || !SbReadEntireFile(depfile, &sb)) {
+        VL_ReturnDefer(VL_NeedsRebuild(output_path, input_path));
+    }
+
+    DaAppend(&inputs, input_path);
+    // NOTE: "output: input dep1 dep2" where long lists get split in lines ending with a backslash,
+    // input is already in inputs but checking it twice doesn't matter
+    view data = ViewFromParts(sb.items, sb.count);
+    ViewChopByView(&data, VIEW(": "));
+    for(;;) {
+        data = ViewTrimLeft(data);
+        if(data.count == 0) break;
+        size_t len = 0;
+        while(len < data.count && !is_space(data.items[len])) len++;
+        view dep = ViewFromParts(data.items, len);
+        data.items += len;
+        data.count -= len;
+        if(ViewEq(dep, VIEW("\\"))) continue;
+
+        const char *path = temp_strndup(dep.items, dep.count);
+        // An #included file got removed, the compiler will say if it's still needed
+        if(!VL_FileExists(path)) VL_ReturnDefer(1);
+        DaAppend(&inputs, path);
+    }
+
+    result = VL_NeedsRebuild_Impl(output_path, inputs.items, inputs.count);
+
+defer:
+    SbFree(sb);
+    DaFree(inputs);
+    temp_rewind(tempMark);
+    return result;
+}
+
+VLIBPROC char *VL_GetFilePathFromCompileCtx(vl_compile_ctx *ctx)
+{
+    AssertMsg(ctx->outputPath || (ctx->type == Compile_Object),
+        "Output path must be specified unless compiling for object file output");
+    if(!ctx->outputPath) return 0;
+    char *output = temp_sprintf("%s/%s", ctx->outputDir ? ctx->outputDir : ".", ctx->outputPath);
+#if OS_WINDOWS
+    if(ctx->type == Compile_Executable) {
+        output = temp_sprintf("%s.exe", output);
+    }
+#else
+    if(ctx->type == Compile_Executable) {}
+#endif
+    else if(ctx->type == Compile_Object) {
+        if(output) {
+            if(ctx->cc == CCompiler_MSVC) {
+                output = temp_sprintf("%s.obj", output);
+            } else {
+                output = temp_sprintf("%s.o", output);
+            }
+        }
+    } else if(ctx->type == Compile_DynamicLibrary) {
+        output = temp_sprintf("%s" VL_DLL_EXTENSION, output);
+    } else if(ctx->type == Compile_StaticLibrary) {
+        if(ctx->cc == CCompiler_MSVC) {
+            output = temp_sprintf("%s.obj", output);
+        } else {
+            output = temp_sprintf("%s.o", output);
+        }
+    } else if(ctx->type == Compile_PrecompiledHeader) {
+        if(ctx->cc == CCompiler_GCC) {
+            output = temp_sprintf("%s.gch", output);
+        } else {
+            output = temp_sprintf("%s.pch", output);
+        }
+    }
+    return output;
+}
+
+vl_needrebuild_context VL_needsRebuildContext = {0};
+bool VL_ContentHashRebuilds = VL_BUILD_CONTENT_HASH;
+bool VL_CompileCache = VL_BUILD_COMPILE_CACHE;
+const char *VL_CompileCacheDir = VL_BUILD_COMPILE_CACHE_DIR;
+u64 VL_CompileCacheMaxSize = VL_BUILD_COMPILE_CACHE_MAX_SIZE;
+
+#define VL__DEPS_CACHE_MAGIC 0x43444c56 // "VLDC"
+#define VL__DEPS_CACHE_VERSION 1
+
+// Precise filetime, 0 if the file doesn't exist. size can be NULL
+static u64 VL__FileTimeAndSize(const char *path, u64 *size)
+{
+#if OS_WINDOWS
+    WIN32_FILE_ATTRIBUTE_DATA data;
+    if(!GetFileAttributesExA(path, GetFileExInfoStandard, &data)) return 0;
+    if(size) *size = ((u64)data.nFileSizeHigh << 32) | (u64)data.nFileSizeLow;
+    return ((u64)data.ftLastWriteTime.dwHighDateTime << 32) | (u64)data.ftLastWriteTime.dwLowDateTime;
+#else
+    struct stat attr;
+    if(stat(path, &attr) < 0) return 0;
+    if(size) *size = (u64)attr.st_size;
+# if OS_MAC
+    return (u64)attr.st_mtimespec.tv_sec*VL_NANOS_PER_SEC + (u64)attr.st_mtimespec.tv_nsec;
+# else
+    return (u64)attr.st_mtim.tv_sec*VL_NANOS_PER_SEC + (u64)attr.st_mtim.tv_nsec;
+# endif
+#endif
+}
+
+static u64 VL__FileTime(const char *path)
+{
+    return VL__FileTimeAndSize(path, 0);
+}
+
+VLIBPROC u64 VL_GetCachedFileTime(view file)
+{
+    vl_needrebuild_context *ctx = &VL_needsRebuildContext;
+
+    char path[VL_PATH_MAX+1];
+    if(file.count == 0 || file.count > VL_PATH_MAX) return 0;
+    mem_copy_non_overlapping(path, file.items, file.count);
+    path[file.count] = '\0';
+
+    if(!ctx->Arena) {
+        static memory_arena filetimeArena;
+        void *base = VL_REALLOC(NULL, VL_BUILD_FILETIME_ARENA_SIZE);
+        Assert(base != NULL && "Buy more RAM lol!!");
+        ArenaInit(&filetimeArena, VL_BUILD_FILETIME_ARENA_SIZE, base);
+        ctx->Arena = &filetimeArena;
+    }
+    if(!ctx->table.nodes.items) {
+        ctx->table.nodes.items = (vl_filetime_node*)VL_REALLOC(NULL, VL_BUILD_FILETIME_TABLE_SIZE*sizeof(vl_filetime_node));
+        Assert(ctx->table.nodes.items != NULL && "Buy more RAM lol!!");
+        memset(ctx->table.nodes.items, 0, VL_BUILD_FILETIME_TABLE_SIZE*sizeof(vl_filetime_node));
+        ctx->table.nodes.count = VL_BUILD_FILETIME_TABLE_SIZE;
+        ctx->table.nodes.capacity = VL_BUILD_FILETIME_TABLE_SIZE;
+    }
+
+    u64 hash;
+    VL_BUILD_FILENAME_HASH(file, hash);
+    vl_filetime_node *node = &ctx->table.nodes.items[hash % VL_BUILD_FILETIME_TABLE_SIZE];
+    if(node->file.count > 0) {
+        for(;;) {
+            if(ViewEq(node->file, file)) return node->time;
+            if(!node->next) break;
+            node = node->next;
+        }
+    }
+
+    u64 time = VL__FileTime(path);
+
+    // NOTE: if the arena is full, the time just doesn't get cached
+    if(ArenaGetRemaining(ctx->Arena, .Alignment = 8) < sizeof(vl_filetime_node) + file.count + 16) {
+        return time;
+    }
+    if(node->file.count > 0) {
+        node->next = (vl_filetime_node*)PushStruct(ctx->Arena, vl_filetime_node, .Alignment = 8);
+        node = node->next;
+    }
+    node->file = ViewFromParts(Arena_strndup(ctx->Arena, file.items, file.count), file.count);
+    node->time = time;
+    node->next = 0;
+    ctx->table.countTimes++;
+
+    return time;
+}
+
+VLIBPROC void VL_ForgetFileTimes(void)
+{
+    vl_needrebuild_context *ctx = &VL_needsRebuildContext;
+    if(ctx->table.nodes.items) {
+        memset(ctx->table.nodes.items, 0, VL_BUILD_FILETIME_TABLE_SIZE*sizeof(vl_filetime_node));
+    }
+    if(ctx->Arena) ctx->Arena->used = 0;
+    ctx->table.countTimes = 0;
+}
+
+static u64 VL__HashBytes(u64 hash, const void *data, size_t size)
+{
+    /* djb2, same as VL_BUILD_FILENAME_HASH */
+    const u8 *bytes = (const u8*)data;
+    for(size_t i = 0; i < size; i++) hash = ((hash << 5) + hash) + bytes[i];
+    return hash;
+}
+
+static u64 VL__HashPaths(u64 hash, vl_file_paths paths)
+{
+    for(size_t i = 0; i < paths.count; i++) {
+        hash = VL__HashBytes(hash, paths.items[i], strlen(paths.items[i]) + 1);
+    }
+    return VL__HashBytes(hash, &paths.count, sizeof(paths.count));
+}
+
+// Everything that changes the compiler command except the output path
+static u64 VL__HashCompileFlags(vl_compile_ctx *ctx)
+{
+    u8 options[] = {
+        (u8)ctx->cc, (u8)ctx->type, (u8)ctx->optimize, ctx->debug, ctx->incremental,
+        ctx->gcSections, ctx->warnings, ctx->warningsAsErrors,
+    };
+    u64 hash = VL__HashBytes(5381, options, sizeof(options));
+    hash = VL__HashPaths(hash, ctx->sourceFiles);
+    hash = VL__HashPaths(hash, ctx->includePaths);
+    hash = VL__HashPaths(hash, ctx->extraCompilerFlags);
+    hash = VL__HashPaths(hash, ctx->extraMsvcFlags);
+    hash = VL__HashPaths(hash, ctx->extraGccClangFlags);
+    hash = VL__HashPaths(hash, ctx->extraGccFlags);
+    hash = VL__HashPaths(hash, ctx->extraClangFlags);
+    hash = VL__HashPaths(hash, ctx->libPaths);
+    hash = VL__HashPaths(hash, ctx->libs);
+    if(ctx->precompiledHeader) {
+        hash = VL__HashBytes(hash, ctx->precompiledHeader, strlen(ctx->precompiledHeader) + 1);
+    }
+    return hash;
+}
+
+// times can be NULL to take the current filetimes of deps
+static vl_deps_entry *VL__DepsCreate(view output, u64 cmdHash, view *deps, u64 *times, size_t depCount)
+{
+    size_t size = sizeof(vl_deps_entry) + depCount*(sizeof(u64) + sizeof(view)) + output.count + 1;
+    for(size_t i = 0; i < depCount; i++) size += deps[i].count + 1;
+
+    u8 *mem = (u8*)VL_REALLOC(NULL, size);
+    Assert(mem != NULL && "Buy more RAM lol!!");
+
+    vl_deps_entry *entry = (vl_deps_entry*)mem;
+    mem += sizeof(vl_deps_entry);
+    entry->times = (u64*)mem;
+    mem += depCount*sizeof(u64);
+    entry->deps = (view*)mem;
+    mem += depCount*sizeof(view);
+
+    char *names = (char*)mem;
+    mem_copy_non_overlapping(names, output.items, output.count);
+    names[output.count] = '\0';
+    entry->output = ViewFromParts(names, output.count);
+    names += output.count + 1;
+
+    for(size_t i = 0; i < depCount; i++) {
+        mem_copy_non_overlapping(names, deps[i].items, deps[i].count);
+        names[deps[i].count] = '\0';
+        entry->deps[i] = ViewFromParts(names, deps[i].count);
+        entry->times[i] = times ? times[i] : VL_GetCachedFileTime(entry->deps[i]);
+        names += deps[i].count + 1;
+    }
+
+    entry->cmdHash = cmdHash;
+    entry->depCount = (u32)depCount;
+    entry->next = 0;
+    return entry;
+}
+
+static vl_deps_entry *VL__DepsFind(view output)
+{
+    for(vl_deps_entry *entry = VL_needsRebuildContext.deps; entry; entry = entry->next) {
+        if(ViewEq(entry->output, output)) return entry;
+    }
+    return 0;
+}
+
+static void VL__DepsRemove(view output)
+{
+    for(vl_deps_entry **at = &VL_needsRebuildContext.deps; *at; at = &(*at)->next) {
+        if(ViewEq((*at)->output, output)) {
+            vl_deps_entry *entry = *at;
+            *at = entry->next;
+            VL_FREE(entry);
+            VL_needsRebuildContext.depsChanged = true;
+            return;
+        }
+    }
+}
+
+static void VL__DepsSet(vl_deps_entry *entry)
+{
+    VL__DepsRemove(entry->output);
+    entry->next = VL_needsRebuildContext.deps;
+    VL_needsRebuildContext.deps = entry;
+    VL_needsRebuildContext.depsChanged = true;
+}
+
+static bool VL__ReadBytes(u8 **at, u8 *end, void *dst, size_t size)
+{
+    if((size_t)(end - *at) < size) return false;
+    mem_copy_non_overlapping(dst, *at, size);
+    *at += size;
+    return true;
+}
+
+static bool VL__DepsLoadEntry(u8 **at, u8 *end)
+{
+    bool result = true;
+    size_t tempMark = temp_save();
+
+    u64 cmdHash;
+    u32 outputLen, depCount;
+    if(!VL__ReadBytes(at, end, &cmdHash, sizeof(cmdHash)) ||
+       !VL__ReadBytes(at, end, &outputLen, sizeof(outputLen)) ||
+       !VL__ReadBytes(at, end, &depCount, sizeof(depCount)) ||
+       (size_t)(end - *at) < outputLen ||
+       ArenaGetRemaining(&ArenaTemp, .Alignment = 8) < (size_t)depCount*(sizeof(view) + sizeof(u64)) + 16)
+    {
+        VL_ReturnDefer(false);
+    }
+    view output = ViewFromParts((const char*)*at, outputLen);
+    *at += outputLen;
+
+    view *deps = (view*)temp_alloc(depCount*sizeof(view), .Alignment = 8);
+    u64 *times = (u64*)temp_alloc(depCount*sizeof(u64), .Alignment = 8);
+    for(u32 i = 0; i < depCount; i++) {
+        u32 len;
+        if(!VL__ReadBytes(at, end, &times[i], sizeof(u64)) ||
+           !VL__ReadBytes(at, end, &len, sizeof(len)) ||
+           (size_t)(end - *at) < len)
+        {
+            VL_ReturnDefer(false);
+        }
+        deps[i] = ViewFromParts((const char*)*at, len);
+        *at += len;
+    }
+
+    VL__DepsSet(VL__DepsCreate(output, cmdHash, deps, times, depCount));
+
+defer:
+    temp_rewind(tempMark);
+    return result;
+}
+
+static void VL__DepsLoad(void)
+{
+    if(VL_needsRebuildContext.depsLoaded) return;
+    VL_needsRebuildContext.depsLoaded = true;
+    if(!VL_FileExists(VL_BUILD_DEPS_CACHE_PATH)) return;
+
+    string_builder sb = {0};
+    if(!SbReadEntireFile(VL_BUILD_DEPS_CACHE_PATH, &sb)) return;
+
+    u8 *at = (u8*)sb.items;
+    u8 *end = at + sb.count;
+    u32 header[3];
+    if(!VL__ReadBytes(&at, end, header, sizeof(header)) ||
+       header[0] != VL__DEPS_CACHE_MAGIC || header[1] != VL__DEPS_CACHE_VERSION)
+    {
+        VL_Log(VL_WARNING, "Ignoring dependency cache '%s' from another version", VL_BUILD_DEPS_CACHE_PATH);
+        SbFree(sb);
+        return;
     }
 
-    if(WIFEXITED(wstatus)) {
-        int exit_status = WEXITSTATUS(wstatus);
-        if(exit_status != 0) {
-            VL_Log(VL_ERROR, "command exited with exit code %d", exit_status);
-            return -1;
+    for(u32 entryIdx = 0; entryIdx < header[2]; entryIdx++) {
+        if(!VL__DepsLoadEntry(&at, end)) {
+            VL_Log(VL_WARNING, "Dependency cache '%s' is corrupted, ignoring the rest of it", VL_BUILD_DEPS_CACHE_PATH);
+            break;
         }
-
-        return 1;
     }
 
-    if(WIFSIGNALED(wstatus)) {
-        VL_Log(VL_ERROR, "command process was terminated by signal %d", WTERMSIG(wstatus));
-        return -1;
+    VL_needsRebuildContext.depsChanged = false;
+    SbFree(sb);
+}
+
+static bool VL__DepsSave(void)
+{
+    vl_needrebuild_context *ctx = &VL_needsRebuildContext;
+    if(!ctx->depsChanged || ctx->batchSaves) return true;
+
+    string_builder sb = {0};
+    u32 header[3] = {VL__DEPS_CACHE_MAGIC, VL__DEPS_CACHE_VERSION, 0};
+    for(vl_deps_entry *entry = VL_needsRebuildContext.deps; entry; entry = entry->next) header[2]++;
+    SbAppendBuf(&sb, header, sizeof(header));
+
+    for(vl_deps_entry *entry = VL_needsRebuildContext.deps; entry; entry = entry->next) {
+        u32 outputLen = (u32)entry->output.count;
+        SbAppendBuf(&sb, &entry->cmdHash, sizeof(entry->cmdHash));
+        SbAppendBuf(&sb, &outputLen, sizeof(outputLen));
+        SbAppendBuf(&sb, &entry->depCount, sizeof(entry->depCount));
+        SbAppendBuf(&sb, entry->output.items, entry->output.count);
+        for(u32 i = 0; i < entry->depCount; i++) {
+            u32 len = (u32)entry->deps[i].count;
+            SbAppendBuf(&sb, &entry->times[i], sizeof(u64));
+            SbAppendBuf(&sb, &len, sizeof(len));
+            SbAppendBuf(&sb, entry->deps[i].items, entry->deps[i].count);
+        }
     }
 
-    nanosleep(&duration, NULL);
-    return 0;
-#endif
+    bool ok = (VL_FileExists(VL_BUILD_CACHE_DIR) || MkdirIfNotExist(VL_BUILD_CACHE_DIR)) &&
+              WriteEntireFile(VL_BUILD_DEPS_CACHE_PATH, sb.items, sb.count);
+    if(!ok) VL_Log(VL_WARNING, "Could not write dependency cache '%s'", VL_BUILD_DEPS_CACHE_PATH);
+    ctx->depsChanged = false;
+    SbFree(sb);
+    return ok;
 }
 
-// Wait until all the processes have finished
-VLIBPROC bool VL_ProcsWait(vl_procs procs)
+#define VL__HASH_CACHE_MAGIC 0x43484c56 // "VLHC"
+#define VL__HASH_CACHE_VERSION 1
+
+static vl_hash_entry *VL__HashEntryFind(vl_hash_entry *list, view path)
 {
-    bool ok = true;
-    for(size_t i = 0; i < procs.count; ++i) {
-        ok = VL_ProcWait(procs.items[i]) && ok;
+    for(vl_hash_entry *entry = list; entry; entry = entry->next) {
+        if(ViewEq(entry->path, path)) return entry;
     }
-    return ok;
+    return 0;
 }
 
-// Wait until all the processes have finished and empty the procs array.
-VLIBPROC bool VL_ProcsFlush(vl_procs *procs)
+static void VL__HashEntrySet(vl_hash_entry **list, view path, u64 size, u64 time, u64 hash)
 {
-    bool ok = VL_ProcsWait(*procs);
-    procs->count = 0;
-    return ok;
+    vl_hash_entry *entry = VL__HashEntryFind(*list, path);
+    if(!entry) {
+        u8 *mem = (u8*)VL_REALLOC(NULL, sizeof(vl_hash_entry) + path.count + 1);
+        Assert(mem != NULL && "Buy more RAM lol!!");
+        entry = (vl_hash_entry*)mem;
+        char *name = (char*)(mem + sizeof(vl_hash_entry));
+        mem_copy_non_overlapping(name, path.items, path.count);
+        name[path.count] = '\0';
+        entry->path = ViewFromParts(name, path.count);
+        entry->next = *list;
+        *list = entry;
+    } else if(entry->size == size && entry->time == time && entry->hash == hash) {
+        return;
+    }
+
+    entry->size = size;
+    entry->time = time;
+    entry->hash = hash;
+    VL_needsRebuildContext.hashesChanged = true;
 }
 
-VLIBPROC void VL_CmdRender(vl_cmd cmd, string_builder *render)
+static bool VL__HashesLoadList(u8 **at, u8 *end, vl_hash_entry **list, u32 count)
 {
-    for(size_t i = 0; i < cmd.count; ++i) {
-        const char *arg = cmd.items[i];
-        if(arg == NULL) break;
-        if(i > 0) SbAppendCstr(render, " ");
-        if(!strchr(arg, ' ')) {
-            SbAppendCstr(render, arg);
-        } else {
-            DaAppend(render, '\'');
-            SbAppendCstr(render, arg);
-            DaAppend(render, '\'');
+    for(u32 i = 0; i < count; i++) {
+        u64 values[3];
+        u32 len;
+        if(!VL__ReadBytes(at, end, values, sizeof(values)) ||
+           !VL__ReadBytes(at, end, &len, sizeof(len)) ||
+           (size_t)(end - *at) < len)
+        {
+            return false;
         }
+        VL__HashEntrySet(list, ViewFromParts((const char*)*at, len), values[0], values[1], values[2]);
+        *at += len;
     }
+    return true;
 }
 
-VLIBPROC bool CmdRun_Opt(vl_cmd_opts opt)
+static void VL__HashesLoad(void)
 {
-    bool result = true;
-    vl_fd fdin = VL_INVALID_FD;
-    vl_fd fdout = VL_INVALID_FD;
-    vl_fd fderr = VL_INVALID_FD;
-    vl_proc proc = VL_INVALID_PROC;
-    vl_fd *optFdin = 0;
-    vl_fd *optFdout = 0;
-    vl_fd *optFderr = 0;
+    vl_needrebuild_context *ctx = &VL_needsRebuildContext;
+    if(ctx->hashesLoaded) return;
+    ctx->hashesLoaded = true;
+    if(!VL_FileExists(VL_BUILD_HASH_CACHE_PATH)) return;
 
-    size_t max_procs = opt.maxProcs > 0 ? opt.maxProcs : (size_t) VL_GetCountProcs() + 1;
+    string_builder sb = {0};
+    if(!SbReadEntireFile(VL_BUILD_HASH_CACHE_PATH, &sb)) return;
 
-    if(opt.async && max_procs > 0) {
-        while(opt.async->count >= max_procs) {
-            for(size_t i = 0; i < opt.async->count; ++i) {
-                int ret = VL__ProcWaitAsync(opt.async->items[i], 1);
-                if(ret < 0) VL_ReturnDefer(false);
-                if(ret) {
-                    DaRemoveUnordered(opt.async, i);
-                    break;
-                }
-            }
-        }
+    u8 *at = (u8*)sb.items;
+    u8 *end = at + sb.count;
+    u32 header[4];
+    if(!VL__ReadBytes(&at, end, header, sizeof(header)) ||
+       header[0] != VL__HASH_CACHE_MAGIC || header[1] != VL__HASH_CACHE_VERSION)
+    {
+        VL_Log(VL_WARNING, "Ignoring hash cache '%s' from another version", VL_BUILD_HASH_CACHE_PATH);
+    } else if(!VL__HashesLoadList(&at, end, &ctx->fileHashes, header[2]) ||
+              !VL__HashesLoadList(&at, end, &ctx->outputStamps, header[3]))
+    {
+        VL_Log(VL_WARNING, "Hash cache '%s' is corrupted, ignoring the rest of it", VL_BUILD_HASH_CACHE_PATH);
     }
 
-    if(opt.stdinPath) {
-        fdin = VL_FopenForRead(opt.stdinPath);
-        if(fdin == VL_INVALID_FD) VL_ReturnDefer(false);
-        optFdin = &fdin;
-    }
-    if(opt.stdoutPath) {
-        fdout = VL_FopenForWrite(opt.stdoutPath);
-        if(fdout == VL_INVALID_FD) VL_ReturnDefer(false);
-        optFdout = &fdout;
-    }
-    if(opt.stderrPath) {
-        fderr = VL_FopenForWrite(opt.stderrPath);
-        if(fderr == VL_INVALID_FD) VL_ReturnDefer(false);
-        optFderr = &fderr;
-    }
-    proc = VL_CmdStartProcess(*opt.cmd, optFdin, optFdout, optFderr, true);
+    ctx->hashesChanged = false;
+    SbFree(sb);
+}
 
-    if(opt.async) {
-        if(proc == VL_INVALID_PROC) VL_ReturnDefer(false);
-        DaAppend(opt.async, proc);
-    } else {
-        if(!VL_ProcWait(proc)) VL_ReturnDefer(false);
+static void VL__HashesSaveList(string_builder *sb, vl_hash_entry *list)
+{
+    for(vl_hash_entry *entry = list; entry; entry = entry->next) {
+        u64 values[3] = {entry->size, entry->time, entry->hash};
+        u32 len = (u32)entry->path.count;
+        SbAppendBuf(sb, values, sizeof(values));
+        SbAppendBuf(sb, &len, sizeof(len));
+        SbAppendBuf(sb, entry->path.items, entry->path.count);
     }
-
-defer:
-    if(optFdin)  VL_FileClose(*optFdin);
-    if(optFdout) VL_FileClose(*optFdout);
-    if(optFderr) VL_FileClose(*optFderr);
-    opt.cmd->count = 0;
-#if OS_WINDOWS
-    opt.cmd->msvc_linkflags = 0;
-#endif
-    return result;
 }
 
-VLIBPROC int VL_GetCountProcs(void)
+static bool VL__HashesSave(void)
 {
-    static int count = 0;
-    if(count != 0) return count;
-#ifdef _WIN32
-    SYSTEM_INFO siSysInfo;
-    GetSystemInfo(&siSysInfo);
-    count = siSysInfo.dwNumberOfProcessors;
-#else
-    count = sysconf(_SC_NPROCESSORS_ONLN);
-#endif
-    return count;
+    vl_needrebuild_context *ctx = &VL_needsRebuildContext;
+    if(!ctx->hashesChanged || ctx->batchSaves) return true;
+
+    string_builder sb = {0};
+    u32 header[4] = {VL__HASH_CACHE_MAGIC, VL__HASH_CACHE_VERSION, 0, 0};
+    for(vl_hash_entry *entry = ctx->fileHashes; entry; entry = entry->next) header[2]++;
+    for(vl_hash_entry *entry = ctx->outputStamps; entry; entry = entry->next) header[3]++;
+    SbAppendBuf(&sb, header, sizeof(header));
+    VL__HashesSaveList(&sb, ctx->fileHashes);
+    VL__HashesSaveList(&sb, ctx->outputStamps);
+
+    bool ok = (VL_FileExists(VL_BUILD_CACHE_DIR) || MkdirIfNotExist(VL_BUILD_CACHE_DIR)) &&
+              WriteEntireFile(VL_BUILD_HASH_CACHE_PATH, sb.items, sb.count);
+    if(!ok) VL_Log(VL_WARNING, "Could not write hash cache '%s'", VL_BUILD_HASH_CACHE_PATH);
+    ctx->hashesChanged = false;
+    SbFree(sb);
+    return ok;
 }
 
-VLIBPROC char *temp_sprintf(const char *fmt, ...)
+// Like VL_GetFileHash but doesn't save the cache
+static bool VL__FileHash(view file, u64 *hash)
 {
-    va_list args;
-    va_start(args, fmt);
-    int n = vsnprintf(NULL, 0, fmt, args);
-    va_end(args);
+    bool result = true;
+    size_t tempMark = temp_save();
+    string_builder sb = {0};
 
-    Assert(n >= 0);
-    char *result = (char*)ArenaPushSize(&ArenaTemp, n + 1, .Alignment = 1);
-    va_start(args, fmt);
-    vsnprintf(result, n + 1, fmt, args);
-    va_end(args);
+    VL__HashesLoad();
+    const char *path = temp_strndup(file.items, file.count);
+    u64 size;
+    u64 time = VL__FileTimeAndSize(path, &size);
+    if(time == 0) VL_ReturnDefer(false);
+
+    vl_hash_entry *entry = VL__HashEntryFind(VL_needsRebuildContext.fileHashes, file);
+    if(entry && entry->size == size && entry->time == time) {
+        *hash = entry->hash;
+        VL_ReturnDefer(true);
+    }
 
+    if(!SbReadEntireFile(path, &sb)) VL_ReturnDefer(false);
+    *hash = VL_Hash64(sb.items, sb.count, 0);
+    VL__HashEntrySet(&VL_needsRebuildContext.fileHashes, file, size, time, *hash);
+
+defer:
+    SbFree(sb);
+    temp_rewind(tempMark);
     return result;
 }
 
-VLIBPROC const char *VL_PathName(const char *path)
+VLIBPROC bool VL_GetFileHash(const char *path, u64 *hash)
 {
-#ifdef _WIN32
-    const char *p1 = strrchr(path, '/');
-    const char *p2 = strrchr(path, '\\');
-    const char *p = (p1 > p2)? p1 : p2;  // NULL is ignored if the other search is successful
-    return p ? p + 1 : path;
-#else
-    const char *p = strrchr(path, '/');
-    return p ? p + 1 : path;
-#endif // _WIN32
+    bool ok = VL__FileHash(ViewFromCstr(path), hash);
+    VL__HashesSave();
+    return ok;
 }
 
-VLIBPROC bool VL_Rename(const char *old_path, const char *new_path)
+// Second opinion on a filetime based rebuild check (result) when VL_ContentHashRebuilds is set:
+// when the inputs hash the same as the last time the output was up to date, it doesn't need a rebuild
+static int VL__ContentHashCheck(view output, u64 outputFileTime, const view *inputs, size_t count, int result)
 {
-    VL_Log(VL_ECHO, "renaming %s -> %s", old_path, new_path);
-#ifdef _WIN32
-    if(!MoveFileEx(old_path, new_path, MOVEFILE_REPLACE_EXISTING)) {
-        VL_Log(VL_ERROR, "could not rename %s to %s: %s", old_path, new_path, Win32_ErrorMessage(GetLastError()));
-        return false;
-    }
-#else
-    if(rename(old_path, new_path) < 0) {
-        VL_Log(VL_ERROR, "could not rename %s to %s: %s", old_path, new_path, strerror(errno));
-        return false;
+    if(!VL_ContentHashRebuilds || (result < 0) || (outputFileTime == 0)) return result;
+
+    u64 inputsHash = VL_Hash64(&count, sizeof(count), 0);
+    for(size_t i = 0; i < count; i++) {
+        u64 fileHash;
+        // NOTE: if a file can't be read, keep the filetime decision (it will probably fail to compile)
+        if(!VL__FileHash(inputs[i], &fileHash)) return result;
+        inputsHash = VL_Hash64(inputs[i].items, inputs[i].count, inputsHash ^ fileHash);
     }
-#endif // _WIN32
-    return true;
-}
 
-VLIBPROC bool VL_GetLastWriteTime(const char *file, u64 *writeTime)
-{
-    bool result = true;
-    if(!GetLastWriteTime(file, writeTime)) {
-#ifdef _WIN32
-        VL_Log(VL_ERROR, "Could not get filetime of '%s': %s", file, Win32_ErrorMessage(GetLastError()));
-#else
-        VL_Log(VL_ERROR, "Could not get filetime of '%s': %s", file, strerror(errno));
-#endif
-        result = false;
+    vl_needrebuild_context *ctx = &VL_needsRebuildContext;
+    if(result == 0) {
+        VL__HashEntrySet(&ctx->outputStamps, output, 0, outputFileTime, inputsHash);
+    } else {
+        vl_hash_entry *stamp = VL__HashEntryFind(ctx->outputStamps, output);
+        if(stamp && (stamp->time == outputFileTime) && (stamp->hash == inputsHash)) {
+            VL_Log(VL_INFO, VIEW_FMT" is up to date, its inputs are newer but have the same contents", VIEW_ARG(output));
+            result = 0;
+        }
     }
+
+    VL__HashesSave();
     return result;
 }
 
-VLIBPROC int VL_NeedsRebuild_Impl(const char *output_path, const char **input_paths, size_t input_paths_count)
+VLIBPROC int VL_Needs_C_Rebuild(vl_cmd *cmd, vl_compile_ctx *ctx)
 {
-    u64 outputFileTime;
-    if(!GetLastWriteTime(output_path, &outputFileTime)) return 1;
-
-    for(size_t i = 0; i < input_paths_count; ++i) {
-        const char *input_path = input_paths[i];
-        u64 inputFileTime;
-        if(!VL_GetLastWriteTime(input_path, &inputFileTime)) return -1;
+    int result = 0;
+    size_t iniMark = temp_save();
+    u64 traceStart = VL_TraceClock();
+    vl_proc proc = VL_INVALID_PROC;
+    vl_fd read = VL_INVALID_FD;
+    vl_fd write;
+    const char *output = 0;
 
-        // NOTE: if even a single input_path is fresher than output_path that's 100% rebuild
-        if(inputFileTime > outputFileTime) return 1;
+    if(!ctx->outputDir) {
+        ctx->outputDir = ".";
     }
+    output = VL_GetFilePathFromCompileCtx(ctx);
+    if(!output) VL_ReturnDefer(1);
+    u64 cmdHash = VL__HashCompileFlags(ctx);
+
+    // NOTE: The output is not cached, it changes every time it gets rebuilt
+    u64 outputFileTime = VL__FileTime(output);
+    if(outputFileTime == 0) VL_ReturnDefer(1);
+
+    VL__DepsLoad();
+    vl_deps_entry *entry = VL__DepsFind(ViewFromCstr(output));
+    if(entry) {
+        if(entry->cmdHash != cmdHash) {
+            // Compiled with other flags last time, the dependencies get scanned again after the rebuild
+            VL__DepsRemove(ViewFromCstr(output));
+            VL__DepsSave();
+            VL_ReturnDefer(1);
+        }
 
-    return 0;
-}
-
-VLIBPROC char *VL_GetFilePathFromCompileCtx(vl_compile_ctx *ctx)
-{
-    char *output = temp_sprintf("%s/%s", ctx->outputDir, ctx->output);
-    AssertMsg(output || (ctx->type == Compile_Object),
-        "Output path must be specified unless compiling for object file output");
-#if OS_WINDOWS
-    if(ctx->type == Compile_Executable) {
-        output = temp_sprintf("%s.exe", output);
-    }
-#else
-    if(ctx->type == Compile_Executable) {}
-#endif
-    else if(ctx->type == Compile_Object) {
-        if(output) {
-            if(ctx->cc == CCompiler_MSVC) {
-                output = temp_sprintf("%s.obj", output);
-            } else {
-                output = temp_sprintf("%s.o", output);
+        bool depsChanged = false;
+        int depsResult = 0;
+        for(u32 i = 0; i < entry->depCount; i++) {
+            u64 inputFileTime = VL_GetCachedFileTime(entry->deps[i]);
+            // NOTE: if even a single input_path is fresher than output_path that's 100% rebuild
+            if(inputFileTime > outputFileTime) {
+                depsResult = 1;
+                break;
             }
+            if(inputFileTime != entry->times[i]) depsChanged = true;
         }
-    } else if(ctx->type == Compile_DynamicLibrary) {
-        output = temp_sprintf("%s" VL_DLL_EXTENSION, output);
-    } else if(ctx->type == Compile_StaticLibrary) {
-        if(ctx->cc == CCompiler_MSVC) {
-            output = temp_sprintf("%s.obj", output);
-        } else {
-            output = temp_sprintf("%s.o", output);
+
+        // None of the files changed since they were scanned, so the #includes are the same
+        // (if only their filetimes changed, their contents still say which files are #included)
+        if(depsResult || !depsChanged) {
+            VL_ReturnDefer(VL__ContentHashCheck(ViewFromCstr(output), outputFileTime,
+                                                entry->deps, entry->depCount, depsResult));
         }
     }
-    return output;
-}
 
-VLIBPROC int VL_Needs_C_Rebuild(vl_cmd *cmd, vl_compile_ctx *ctx)
-{
+    for(size_t i = 0; i < ctx->sourceFiles.count; i++) {
+        u64 inputFileTime = VL_GetCachedFileTime(ViewFromCstr(ctx->sourceFiles.items[i]));
+        if(inputFileTime == 0) {
+            VL_Log(VL_ERROR, "Could not get filetime of '%s'", ctx->sourceFiles.items[i]);
+            VL_ReturnDefer(-1);
+        }
+        if(inputFileTime > outputFileTime) VL_ReturnDefer(1);
+    }
+
 #if COMPILER_GCC
     CmdAppend(cmd, "gcc", "-MM");
 #elif COMPILER_CLANG
@@ -1392,19 +3571,9 @@ VLIBPROC int VL_Needs_C_Rebuild(vl_cmd *cmd, vl_compile_ctx *ctx)
     CmdAppend(cmd, "cl", "/showIncludes", "/Zs", "/nologo");
 #else
     // unimplemented
-    return -1;
+    VL_ReturnDefer(-1);
 #endif
 
-    size_t iniMark = temp_save();
-
-    const char *output = VL_GetFilePathFromCompileCtx(ctx);
-
-    int needsRebuildSimple = VL_NeedsRebuild_Impl(output, ctx->sourceFiles.items, ctx->sourceFiles.count);
-    if(needsRebuildSimple != 0) {
-        temp_rewind(iniMark);
-        return needsRebuildSimple;
-    }
-
     DaAppendMany(cmd, ctx->sourceFiles.items, ctx->sourceFiles.count);
     struct compiler_info_opts info = {
         .cmd = cmd,
@@ -1413,20 +3582,26 @@ VLIBPROC int VL_Needs_C_Rebuild(vl_cmd *cmd, vl_compile_ctx *ctx)
     for(size_t i = 0; i < ctx->includePaths.count; i++) {
         VL_ccIncludepath_Opt(info, ctx->includePaths.items[i]);
     }
+    // NOTE: so the sources depend on the precompiled header and everything it #includes
+    if(ctx->precompiledHeader) {
+#if COMPILER_CL
+        CmdAppend(cmd, temp_sprintf("/FI%s", ctx->precompiledHeader));
+#else
+        CmdAppend(cmd, "-include", ctx->precompiledHeader);
+#endif
+    }
 
-    int result = 0;
-    vl_fd read;
-    vl_fd write;
     if(!VL_Pipe(&read, &write)) {
         VL_Log(VL_ERROR, "Could not create pipe for VL_Needs_C_Rebuild");
-        temp_rewind(iniMark);
-        return -1;
+        read = VL_INVALID_FD;
+        VL_ReturnDefer(-1);
     }
 
-    vl_proc proc = VL_CmdStartProcess(*cmd, 0, &write, 0, false);
+    proc = VL_CmdStartProcess(*cmd, 0, &write, 0, false);
     VL_FileClose(write);
 
     char *abuf = (char*)ArenaTemp.base + ArenaTemp.used;
+    size_t bufMark = ArenaTemp.used;
 
     char buf[2048];
     for(;;) {
@@ -1443,10 +3618,29 @@ VLIBPROC int VL_Needs_C_Rebuild(vl_cmd *cmd, vl_compile_ctx *ctx)
         ArenaTemp.used += bytesRead;
     }
 
-    size_t callMemSize = ArenaTemp.used - iniMark;
+    bool procOk = VL_ProcWait(proc);
+    proc = VL_INVALID_PROC;
+    if(!procOk) {
+        VL_Log(VL_ERROR, "Could not wait for process to get includes");
+        VL_ReturnDefer(-1);
+    }
+
+    size_t callMemSize = ArenaTemp.used - bufMark;
     view *includes;
     size_t countIncludes = 0;
 
+    // NOTE: the source files go first, so they are part of the dependencies too
+    ArenaTemp.used += ArenaGetAlignmentOffset(&ArenaTemp, sizeof(view));
+    includes = (view*)(ArenaTemp.base + ArenaTemp.used);
+    if(ArenaTemp.used + ctx->sourceFiles.count*sizeof(view) >= ArenaTemp.size) {
+        VL_Log(VL_ERROR, "No memory left in VL_Needs_C_Rebuild");
+        VL_ReturnDefer(-1);
+    }
+    for(size_t i = 0; i < ctx->sourceFiles.count; i++) {
+        includes[countIncludes++] = ViewFromCstr(ctx->sourceFiles.items[i]);
+        ArenaTemp.used += sizeof(view);
+    }
+
 #if COMPILER_GCC || COMPILER_CLANG
     // NOTE: Full format:
     // file1.o: file1.c <include list>
@@ -1454,8 +3648,6 @@ VLIBPROC int VL_Needs_C_Rebuild(vl_cmd *cmd, vl_compile_ctx *ctx)
     // etc.
     view data = ViewTrimRight(ViewFromParts(abuf, callMemSize));
 
-    includes = (view*)(ArenaTemp.base + ArenaTemp.used + ArenaGetAlignmentOffset(&ArenaTemp, sizeof(view)));
-
     ViewIterateLines(&data, lineIdx, line) {
         (void)lineIdx;
         // NOTE: "file.o: "
@@ -1465,6 +3657,7 @@ VLIBPROC int VL_Needs_C_Rebuild(vl_cmd *cmd, vl_compile_ctx *ctx)
 
         while(line.count > 0) {
             view inc = ViewChopByDelim(&line, ' ');
+            if(inc.count == 0) continue;
             if(inc.items[0] == '\\') {
                 /* Skip '\n' and ' ' after '\n' */
                 line = ViewChopByLine(&data);
@@ -1488,8 +3681,6 @@ VLIBPROC int VL_Needs_C_Rebuild(vl_cmd *cmd, vl_compile_ctx *ctx)
     view data = ViewFromParts(abuf, callMemSize);
     //printf(VIEW_FMT, VIEW_ARG(data));
 
-    includes = (view*)(ArenaTemp.base + ArenaTemp.used + ArenaGetAlignmentOffset(&ArenaTemp, sizeof(view)));
-
     ViewIterateLines(&data, lineIdx, line) {
         (void)lineIdx;
         if(ViewChopStartsWith(&line, VIEW("Note: including file: "))) {
@@ -1509,36 +3700,40 @@ VLIBPROC int VL_Needs_C_Rebuild(vl_cmd *cmd, vl_compile_ctx *ctx)
     }
 #endif
 
-    uint64_t outputFileTime;
-    if(!GetLastWriteTime(output, &outputFileTime)) return 1;
-
-    char path[VL_PATH_MAX+1];
     for(size_t i = 0; i < countIncludes; i++) {
         view inc = includes[i];
         if(inc.count > VL_PATH_MAX) {
             VL_Log(VL_WARNING, "Ignoring file '"VIEW_FMT"' because its path is longer than max path",
                    VIEW_ARG(inc));
+            includes[i--] = includes[--countIncludes];
             continue;
         }
 
-        mem_copy_non_overlapping(path, inc.items, inc.count);
-        path[inc.count] = '\0';
-
-        u64 inputFileTime;
-        if(!VL_GetLastWriteTime(path, &inputFileTime)) VL_ReturnDefer(-1);
+        u64 inputFileTime = VL_GetCachedFileTime(inc);
+        if(inputFileTime == 0) {
+            VL_Log(VL_ERROR, "Could not get filetime of '"VIEW_FMT"'", VIEW_ARG(inc));
+            VL_ReturnDefer(-1);
+        }
 
         // NOTE: if even a single input_path is fresher than output_path that's 100% rebuild
-        if(inputFileTime > outputFileTime) VL_ReturnDefer(1);
+        if(inputFileTime > outputFileTime) result = 1;
     }
 
+    VL__DepsSet(VL__DepsCreate(ViewFromCstr(output), cmdHash, includes, 0, countIncludes));
+    VL__DepsSave();
+    result = VL__ContentHashCheck(ViewFromCstr(output), outputFileTime, includes, countIncludes, result);
+
 defer:
-    if(!VL_ProcWait(proc)) {
-        VL_Log(VL_ERROR, "Could not wait for process to get includes");
-        result = -1;
+    if(read != VL_INVALID_FD) VL_FileClose(read);
+    if(proc != VL_INVALID_PROC) VL_ProcWait(proc);
+    cmd->count = 0;
+#if OS_WINDOWS
+    cmd->msvc_linkflags = 0;
+#endif
+    if(VL_Tracing) {
+        const char *state = (result > 0) ? "stale" : (result == 0) ? "up to date" : "failed";
+        VL_TraceSpan("rebuild", temp_sprintf("%s (%s)", output ? output : "?", state), traceStart);
     }
-
-    VL_FileClose(read);
-
     temp_rewind(iniMark);
 
     return result;
@@ -1832,10 +4027,29 @@ VLIBPROC void VL_ccLibpath_Opt(struct compiler_info_opts opt, const char *libpat
     }
 }
 
-VLIBPROC bool VL_CCompile_Opt(vl_compile_ctx *ctx, vl_cmd_opts opt)
+// The header gets precompiled from a wrapper in pchDir that #includes it, so the .gch/.pch
+// can be next to the file that gets -include'd without writing to the header's directory
+static const char *VL__temp_PchDir(vl_compile_ctx *ctx)
+{
+    if(ctx->pchDir) return ctx->pchDir;
+    return temp_sprintf("%s/pch", ctx->outputDir ? ctx->outputDir : ".");
+}
+
+static const char *VL__temp_PchWrapper(vl_compile_ctx *ctx)
+{
+    return temp_sprintf("%s/%s", VL__temp_PchDir(ctx), VL_PathName(ctx->precompiledHeader));
+}
+
+// msvc puts the code for the precompiled header in an object that has to be linked too
+static const char *VL__temp_PchObject(vl_compile_ctx *ctx)
+{
+    return temp_sprintf("%s.obj", VL__temp_PchWrapper(ctx));
+}
+
+VLIBPROC void VL_SetupCCompile(vl_cmd *cmd, vl_compile_ctx *ctx)
 {
     struct compiler_info_opts info = {
-        .cmd = opt.cmd,
+        .cmd = cmd,
         .cc = ctx->cc,
     };
 
@@ -1847,17 +4061,31 @@ VLIBPROC bool VL_CCompile_Opt(vl_compile_ctx *ctx, vl_cmd_opts opt)
 
     // compile only, don't link
     if((ctx->type == Compile_StaticLibrary) ||
-       (ctx->type == Compile_Object))
+       (ctx->type == Compile_Object) ||
+       ((ctx->type == Compile_PrecompiledHeader) && (ctx->cc == CCompiler_MSVC)))
+    {
+        CmdAppend(cmd, "-c");
+    }
+    if((ctx->type == Compile_PrecompiledHeader) && (ctx->cc != CCompiler_MSVC)) {
+        CmdAppend(cmd, "-x", "c-header");
+    }
+
+    DaAppendMany(cmd, ctx->sourceFiles.items, ctx->sourceFiles.count);
+    if(ctx->precompiledHeader && (ctx->cc == CCompiler_MSVC) &&
+       ((ctx->type == Compile_Executable) || (ctx->type == Compile_DynamicLibrary)))
     {
-        CmdAppend(opt.cmd, "-c");
+        CmdAppend(cmd, VL__temp_PchObject(ctx));
     }
 
-    DaAppendMany(opt.cmd, ctx->sourceFiles.items, ctx->sourceFiles.count);
     /* If compiling for an object, output file path is autoassigned by compiler unless specified */
     if(output) {
-        if(((ctx->type == Compile_Object) || (ctx->type == Compile_StaticLibrary)) && (ctx->cc == CCompiler_MSVC))
+        if((ctx->type == Compile_PrecompiledHeader) && (ctx->cc == CCompiler_MSVC)) {
+            const char *name = VL_PathName(ctx->outputPath);
+            CmdAppend(cmd, temp_sprintf("/Yc%s", name), temp_sprintf("/Fp%s", output),
+                      temp_sprintf("-Fo:%s/%s.obj", ctx->outputDir, name));
+        } else if(((ctx->type == Compile_Object) || (ctx->type == Compile_StaticLibrary)) && (ctx->cc == CCompiler_MSVC))
         {
-            CmdAppend(opt.cmd, temp_sprintf("-Fo:%s", output));
+            CmdAppend(cmd, temp_sprintf("-Fo:%s", output));
         } else {
             VL_ccOutput_Opt(info, output);
         }
@@ -1865,13 +4093,13 @@ VLIBPROC bool VL_CCompile_Opt(vl_compile_ctx *ctx, vl_cmd_opts opt)
 
     if(ctx->optimize == Optimize_Speed) {
         if(ctx->cc == CCompiler_MSVC) {
-            CmdAppend(opt.cmd, "-O2");
+            CmdAppend(cmd, "-O2");
         } else if((ctx->cc == CCompiler_GCC) || (ctx->cc == CCompiler_Clang)) {
-            CmdAppend(opt.cmd, "-O3");
+            CmdAppend(cmd, "-O3");
         }
     } else if(ctx->optimize == Optimize_Size) {
         if(ctx->cc != CCompiler_TCC) {
-            CmdAppend(opt.cmd, "-Os");
+            CmdAppend(cmd, "-Os");
         }
     }
 
@@ -1882,16 +4110,39 @@ VLIBPROC bool VL_CCompile_Opt(vl_compile_ctx *ctx, vl_cmd_opts opt)
         VL_ccIncludepath_Opt(info, ctx->includePaths.items[i]);
     }
 
+    /* the header itself is built by VL_PrecompileHeader */
+    if(ctx->precompiledHeader) {
+        const char *wrapper = VL__temp_PchWrapper(ctx);
+        const char *name = VL_PathName(wrapper);
+        switch(ctx->cc) {
+            case CCompiler_GCC: {
+                // NOTE: gcc picks up wrapper.gch by itself, or the header if the .gch doesn't fit the flags
+                CmdAppend(cmd, "-include", wrapper);
+            } break;
+            case CCompiler_Clang: {
+                CmdAppend(cmd, "-include-pch", temp_sprintf("%s.pch", wrapper));
+            } break;
+            case CCompiler_TCC: {
+                CmdAppend(cmd, "-include", ctx->precompiledHeader);
+            } break;
+            case CCompiler_MSVC: {
+                VL_ccIncludepath_Opt(info, VL__temp_PchDir(ctx));
+                CmdAppend(cmd, temp_sprintf("/FI%s", name), temp_sprintf("/Yu%s", name),
+                          temp_sprintf("/Fp%s.pch", wrapper));
+            } break;
+        }
+    }
+
     /* extra compiler flags */
-    DaAppendMany(opt.cmd, ctx->extraCompilerFlags.items, ctx->extraCompilerFlags.count);
+    DaAppendMany(cmd, ctx->extraCompilerFlags.items, ctx->extraCompilerFlags.count);
     if(ctx->cc == CCompiler_MSVC) {
-        DaAppendMany(opt.cmd, ctx->extraMsvcFlags.items, ctx->extraMsvcFlags.count);
+        DaAppendMany(cmd, ctx->extraMsvcFlags.items, ctx->extraMsvcFlags.count);
     } else {
-        DaAppendMany(opt.cmd, ctx->extraGccClangFlags.items, ctx->extraGccClangFlags.count);
+        DaAppendMany(cmd, ctx->extraGccClangFlags.items, ctx->extraGccClangFlags.count);
         if(ctx->cc == CCompiler_GCC) {
-            DaAppendMany(opt.cmd, ctx->extraGccFlags.items, ctx->extraGccFlags.count);
+            DaAppendMany(cmd, ctx->extraGccFlags.items, ctx->extraGccFlags.count);
         } else if(ctx->cc == CCompiler_Clang) {
-            DaAppendMany(opt.cmd, ctx->extraClangFlags.items, ctx->extraClangFlags.count);
+            DaAppendMany(cmd, ctx->extraClangFlags.items, ctx->extraClangFlags.count);
         }
     }
 
@@ -1905,39 +4156,599 @@ VLIBPROC bool VL_CCompile_Opt(vl_compile_ctx *ctx, vl_cmd_opts opt)
     }
 
 #if OS_WINDOWS
-    if((ctx->cc == CCompiler_MSVC) && !opt.cmd->msvc_linkflags) {
-        CmdAppend(opt.cmd, "/link");
-        opt.cmd->msvc_linkflags = true;
+    if((ctx->cc == CCompiler_MSVC) && !cmd->msvc_linkflags) {
+        CmdAppend(cmd, "/link");
+        cmd->msvc_linkflags = true;
     }
 #endif
 
     if(ctx->type == Compile_DynamicLibrary) {
         if(ctx->cc == CCompiler_MSVC) {
-            CmdAppend(opt.cmd, "/DLL");
+            CmdAppend(cmd, "/DLL");
         } else {
-            CmdAppend(opt.cmd, "-shared");
+            CmdAppend(cmd, "-shared");
         }
     }
 
     if(!ctx->incremental && (ctx->cc == CCompiler_MSVC)) {
-        CmdAppend(opt.cmd, "-incremental:no");
+        CmdAppend(cmd, "-incremental:no");
     }
     if(ctx->gcSections) {
         if(ctx->cc == CCompiler_MSVC) {
-            CmdAppend(opt.cmd, "-opt:ref");
+            CmdAppend(cmd, "-opt:ref");
+        } else {
+            CmdAppend(cmd, "-Wl,--gc-sections");
+        }
+    }
+}
+
+static const char *VL__temp_AbsolutePath(const char *path)
+{
+#if OS_WINDOWS
+    bool absolute = (path[0] == '/') || (path[0] == '\\') || (path[0] && path[1] == ':');
+#else
+    bool absolute = (path[0] == '/');
+#endif
+    if(absolute) return path;
+
+    const char *cwd = VL_temp_GetCurrentDir();
+    if(!cwd) return 0;
+    return temp_sprintf("%s/%s", cwd, path);
+}
+
+static bool VL__WriteFileIfChanged(const char *path, const char *text)
+{
+    size_t size = strlen(text);
+    string_builder sb = {0};
+    bool same = VL_FileExists(path) && SbReadEntireFile(path, &sb) &&
+        (sb.count == size) && (memcmp(sb.items, text, size) == 0);
+    SbFree(sb);
+    // NOTE: rewriting it would make everything that depends on it stale every time
+    if(same) return true;
+    return WriteEntireFile(path, text, size);
+}
+
+VLIBPROC bool VL_PrecompileHeader(vl_compile_ctx *ctx)
+{
+    // tcc has no precompiled headers, the header just gets -include'd
+    if(!ctx->precompiledHeader || (ctx->cc == CCompiler_TCC)) return true;
+
+    bool result = true;
+    size_t tempMark = temp_save();
+    vl_cmd cmd = {0};
+
+    if(!ctx->outputDir) {
+        ctx->outputDir = ".";
+    }
+    const char *pchDir = VL__temp_PchDir(ctx);
+    if(!VL_FileExists(pchDir) && !MkdirIfNotExist(pchDir)) VL_ReturnDefer(false);
+
+    // NOTE: absolute, so the wrapper includes the same file from any directory
+    const char *header = VL__temp_AbsolutePath(ctx->precompiledHeader);
+    if(!header) VL_ReturnDefer(false);
+
+    const char *wrapper = VL__temp_PchWrapper(ctx);
+    const char *source = wrapper;
+    if(!VL__WriteFileIfChanged(wrapper, temp_sprintf("#include \"%s\"\n", header))) {
+        VL_Log(VL_ERROR, "Could not write '%s'", wrapper);
+        VL_ReturnDefer(false);
+    }
+    if(ctx->cc == CCompiler_MSVC) {
+        // /Yc needs a source file that #includes the header
+        source = temp_sprintf("%s.c", wrapper);
+        if(!VL__WriteFileIfChanged(source, temp_sprintf("#include \"%s\"\n", VL_PathName(wrapper)))) {
+            VL_Log(VL_ERROR, "Could not write '%s'", source);
+            VL_ReturnDefer(false);
+        }
+    }
+
+    vl_compile_ctx pchCtx = *ctx;
+    pchCtx.type = Compile_PrecompiledHeader;
+    pchCtx.parallel = false;
+    pchCtx.gcSections = false;
+    pchCtx.precompiledHeader = 0;
+    pchCtx.sourceFiles = (vl_file_paths){&source, 1, 0};
+    pchCtx.outputPath = VL_PathName(wrapper);
+    pchCtx.outputDir = pchDir;
+    pchCtx.libPaths = (vl_file_paths){0};
+    pchCtx.libs = (vl_file_paths){0};
+
+    int needsRebuild = VL_Needs_C_Rebuild(&cmd, &pchCtx);
+    cmd.count = 0;
+    if(needsRebuild < 0) VL_ReturnDefer(false);
+    if(needsRebuild == 0) VL_ReturnDefer(true);
+
+    VL_SetupCCompile(&cmd, &pchCtx);
+    if(!CmdRun(&cmd)) {
+        VL__DepsRemove(ViewFromCstr(VL_GetFilePathFromCompileCtx(&pchCtx)));
+        VL__DepsSave();
+        VL_ReturnDefer(false);
+    }
+
+defer:
+    CmdFree(cmd);
+    temp_rewind(tempMark);
+    return result;
+}
+
+// "../src/app.c" -> "src_app", so objects of files with the same name in different directories don't collide
+static const char *VL__temp_ObjectName(const char *sourcePath)
+{
+    view path = ViewFromCstr(sourcePath);
+    for(;;) {
+        if(ViewChopStartsWith(&path, VIEW("./")) || ViewChopStartsWith(&path, VIEW(".\\"))) continue;
+        if(ViewChopStartsWith(&path, VIEW("../")) || ViewChopStartsWith(&path, VIEW("..\\"))) continue;
+        break;
+    }
+
+    char *name = temp_strndup(path.items, path.count);
+    char *ext = strrchr(name, '.');
+    if(ext && !strchr(ext, '/') && !strchr(ext, '\\')) *ext = '\0';
+    for(char *c = name; *c; c++) {
+        if(*c == '/' || *c == '\\' || *c == ':') *c = '_';
+    }
+    return name;
+}
+
+// Linking only needs to happen when some object is newer or the link flags changed
+static int VL__NeedsLink(const char *output, u64 cmdHash, vl_file_paths objects)
+{
+    u64 outputFileTime = VL__FileTime(output);
+    if(outputFileTime == 0) return 1;
+
+    VL__DepsLoad();
+    vl_deps_entry *entry = VL__DepsFind(ViewFromCstr(output));
+    if(!entry || entry->cmdHash != cmdHash) return 1;
+
+    for(size_t i = 0; i < objects.count; i++) {
+        // NOTE: not VL_GetCachedFileTime, the objects could have just been rebuilt
+        u64 objectFileTime = VL__FileTime(objects.items[i]);
+        if(objectFileTime == 0) return -1;
+        if(objectFileTime > outputFileTime) return 1;
+    }
+    return 0;
+}
+
+// Runs cmd and appends everything it writes to stdout and stderr to out
+static bool VL__CmdCapture(vl_cmd *cmd, string_builder *out)
+{
+    vl_fd read, write;
+    if(!VL_Pipe(&read, &write)) {
+        VL_Log(VL_ERROR, "Could not create pipe to capture the output of %s", cmd->items[0]);
+        cmd->count = 0;
+        return false;
+    }
+
+    vl_proc proc = VL_CmdStartProcess(*cmd, 0, &write, &write, false);
+    VL_FileClose(write);
+    cmd->count = 0;
+#if OS_WINDOWS
+    cmd->msvc_linkflags = 0;
+#endif
+
+    char buf[4096];
+    uint32_t bytesRead;
+    while(VL_FileRead(read, buf, (uint32_t)sizeof(buf), &bytesRead) && (bytesRead > 0)) {
+        SbAppendBuf(out, buf, bytesRead);
+    }
+    VL_FileClose(read);
+
+    return (proc != VL_INVALID_PROC) && VL_ProcWait(proc);
+}
+
+// Hash of the compiler's version banner, so objects from another compiler version are never reused
+static u64 VL__CompilerIdentity(vl_c_compiler cc)
+{
+    static u64 identities[4];
+    if(identities[cc]) return identities[cc];
+
+    vl_cmd cmd = {0};
+    string_builder banner = {0};
+    VL_cc_Opt((struct compiler_info_opts){.cmd = &cmd, .cc = cc});
+    // NOTE: cl prints its version when it's run without arguments (and fails)
+    if(cc == CCompiler_TCC) CmdAppend(&cmd, "-v");
+    else if(cc != CCompiler_MSVC) CmdAppend(&cmd, "--version");
+    VL__CmdCapture(&cmd, &banner);
+
+    identities[cc] = VL_Hash64(banner.items, banner.count, 0x9e3779b97f4a7c15ull + (u64)cc) | 1;
+    CmdFree(cmd);
+    SbFree(banner);
+    return identities[cc];
+}
+
+// Same flags as the compile of ctx but it only preprocesses into preprocessedPath
+static void VL__SetupPreprocess(vl_cmd *cmd, vl_compile_ctx *ctx, const char *preprocessedPath, vl_file_paths *flags)
+{
+    vl_compile_ctx ppCtx = *ctx;
+    ppCtx.type = Compile_Object;
+    ppCtx.outputPath = 0;
+    ppCtx.precompiledHeader = 0;
+
+    flags->count = 0;
+    DaAppendMany(flags, ctx->extraCompilerFlags.items, ctx->extraCompilerFlags.count);
+    if(ctx->cc == CCompiler_MSVC) {
+        if(ctx->precompiledHeader) DaAppend(flags, temp_sprintf("/FI%s", ctx->precompiledHeader));
+        DaAppend(flags, "/P");
+        DaAppend(flags, temp_sprintf("/Fi%s", preprocessedPath));
+    } else {
+        if(ctx->precompiledHeader) {
+            DaAppend(flags, "-include");
+            DaAppend(flags, ctx->precompiledHeader);
+        }
+        DaAppend(flags, "-E");
+        DaAppend(flags, "-o");
+        DaAppend(flags, preprocessedPath);
+    }
+    ppCtx.extraCompilerFlags = *flags;
+
+    VL_SetupCCompile(cmd, &ppCtx);
+}
+
+// Deletes the preprocessed file, 0 if it could not be read
+static u64 VL__CompileCacheKey(vl_compile_ctx *ctx, const char *preprocessedPath)
+{
+    string_builder sb = {0};
+    u64 key = 0;
+    if(SbReadEntireFile(preprocessedPath, &sb)) {
+        u64 seed = VL__CompilerIdentity(ctx->cc) ^ VL__HashCompileFlags(ctx);
+        if(ctx->debug) {
+            // The debug info has the working directory in it (DW_AT_comp_dir)
+            const char *cwd = VL_temp_GetCurrentDir();
+            seed = VL_Hash64(cwd, strlen(cwd), seed);
+        }
+        key = VL_Hash64(sb.items, sb.count, seed) | 1;
+    }
+    SbFree(sb);
+    remove(preprocessedPath);
+    return key;
+}
+
+static const char *VL__temp_CompileCachePath(vl_compile_ctx *ctx, u64 key)
+{
+    return temp_sprintf("%s/%016llx%s", VL_CompileCacheDir, (unsigned long long)key,
+                        (ctx->cc == CCompiler_MSVC) ? ".obj" : ".o");
+}
+
+// The filetime of the cached objects says when they were last used
+static void VL__TouchFile(const char *path)
+{
+#if OS_WINDOWS
+    HANDLE file = CreateFileA(path, FILE_WRITE_ATTRIBUTES, FILE_SHARE_READ | FILE_SHARE_WRITE, 0,
+                              OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, 0);
+    if(file == INVALID_HANDLE_VALUE) return;
+    FILETIME now;
+    GetSystemTimeAsFileTime(&now);
+    SetFileTime(file, 0, 0, &now);
+    CloseHandle(file);
+#else
+    utime(path, 0);
+#endif
+}
+
+// true if the object was copied from the cache to output
+static bool VL__CompileCacheGet(vl_compile_ctx *ctx, u64 key, const char *output)
+{
+    if(!key) return false;
+    size_t tempMark = temp_save();
+    const char *cached = VL__temp_CompileCachePath(ctx, key);
+    bool hit = VL_FileExists(cached) && VL_CopyFile(cached, output);
+    if(hit) {
+        VL__TouchFile(cached);
+        // NOTE: CopyFile keeps the last write time of the cached object, output has to look
+        // newer than its sources and the executable for the rebuild/relink checks
+        VL__TouchFile(output);
+    }
+    temp_rewind(tempMark);
+    return hit;
+}
+
+static void VL__CompileCachePut(vl_compile_ctx *ctx, u64 key, const char *output)
+{
+    if(!key) return;
+    size_t tempMark = temp_save();
+    if(VL_FileExists(VL_CompileCacheDir) || MkdirIfNotExist(VL_CompileCacheDir)) {
+        // NOTE: copied under another name first, so other builds never see half of an object
+        const char *cached = VL__temp_CompileCachePath(ctx, key);
+        const char *partial = temp_sprintf("%s.%llx.tmp", cached, (unsigned long long)VL_GetNanos());
+        if(VL_CopyFile(output, partial) && !VL_Rename(partial, cached)) remove(partial);
+    }
+    temp_rewind(tempMark);
+}
+
+typedef struct {
+    const char *path;
+    u64 time;
+    u64 size;
+} vl__cached_object;
+
+static int VL__CachedObjectCompareTime(const void *a, const void *b)
+{
+    u64 timeA = ((const vl__cached_object*)a)->time;
+    u64 timeB = ((const vl__cached_object*)b)->time;
+    return (timeA > timeB) - (timeA < timeB);
+}
+
+// Deletes the least recently used objects until the cache is 3/4 of VL_CompileCacheMaxSize
+static void VL__CompileCacheTrim(void)
+{
+    size_t tempMark = temp_save();
+    vl_file_paths names = {0};
+    struct { vl__cached_object *items; size_t count; size_t capacity; } objects = {0};
+    u64 totalSize = 0;
+
+    if(!VL_FileExists(VL_CompileCacheDir) || !VL_ReadEntireDir(VL_CompileCacheDir, &names)) goto defer;
+    for(size_t i = 0; i < names.count; i++) {
+        if(names.items[i][0] == '.') continue;
+        vl__cached_object object = {.path = temp_sprintf("%s/%s", VL_CompileCacheDir, names.items[i])};
+        object.time = VL__FileTimeAndSize(object.path, &object.size);
+        if(object.time == 0) continue;
+        totalSize += object.size;
+        DaAppend(&objects, object);
+    }
+    if(totalSize <= VL_CompileCacheMaxSize) goto defer;
+
+    qsort(objects.items, objects.count, sizeof(*objects.items), VL__CachedObjectCompareTime);
+    for(size_t i = 0; (i < objects.count) && (totalSize > VL_CompileCacheMaxSize/4*3); i++) {
+        if(remove(objects.items[i].path) == 0) totalSize -= objects.items[i].size;
+    }
+
+defer:
+    DaFree(names);
+    DaFree(objects);
+    temp_rewind(tempMark);
+}
+
+static bool VL__CCompileParallel(vl_compile_ctx *ctx, vl_cmd_opts opt)
+{
+    bool result = true;
+    size_t tempMark = temp_save();
+    vl_procs procs = {0};
+    vl_file_paths objects = {0};
+    vl_file_paths stale = {0}; // sources that need a cache lookup
+    vl_file_paths flags = {0};
+    struct { u64 *items; size_t count; size_t capacity; } keys = {0};
+    // NOTE: every object updates the caches, they're written once at the end instead of once per object
+    bool batchingSaves = VL_needsRebuildContext.batchSaves;
+    VL_needsRebuildContext.batchSaves = true;
+
+    if(!ctx->outputDir) {
+        ctx->outputDir = ".";
+    }
+    const char *objectDir = ctx->objectDir ? ctx->objectDir : temp_sprintf("%s/obj", ctx->outputDir);
+    if(!VL_FileExists(objectDir) && !MkdirIfNotExist(objectDir)) VL_ReturnDefer(false);
+
+    size_t maxProcs = opt.maxProcs > 0 ? opt.maxProcs : (size_t)VL_GetCountProcs();
+
+    // NOTE: once, before any of the objects that use it get compiled
+    if(!VL_PrecompileHeader(ctx)) VL_ReturnDefer(false);
+    const char *pchDir = VL__temp_PchDir(ctx);
+
+    vl_compile_ctx objCtx = *ctx;
+    objCtx.type = Compile_Object;
+    objCtx.parallel = false;
+    objCtx.gcSections = false;
+    objCtx.outputDir = objectDir;
+    objCtx.pchDir = pchDir;
+    objCtx.libPaths = (vl_file_paths){0};
+    objCtx.libs = (vl_file_paths){0};
+
+    for(size_t i = 0; i < ctx->sourceFiles.count; i++) {
+        objCtx.sourceFiles = (vl_file_paths){&ctx->sourceFiles.items[i], 1, 0};
+        objCtx.outputPath = VL__temp_ObjectName(ctx->sourceFiles.items[i]);
+
+        const char *object = VL_GetFilePathFromCompileCtx(&objCtx);
+        DaAppend(&objects, object);
+
+        int needsRebuild = VL_Needs_C_Rebuild(opt.cmd, &objCtx);
+        if(needsRebuild < 0) VL_ReturnDefer(false);
+        if(needsRebuild == 0) continue;
+
+        if(VL_CompileCache) {
+            // NOTE: all the sources get preprocessed in parallel first to know which ones are cached
+            DaAppend(&stale, ctx->sourceFiles.items[i]);
+            VL__SetupPreprocess(opt.cmd, &objCtx, temp_sprintf("%s.i", object), &flags);
+        } else {
+            VL_SetupCCompile(opt.cmd, &objCtx);
+        }
+        if(!CmdRun(opt.cmd, .async = &procs, .maxProcs = maxProcs, .captureOutput = true)) VL_ReturnDefer(false);
+    }
+
+    if(!VL_ProcsFlush(&procs)) VL_ReturnDefer(false);
+
+    for(size_t i = 0; i < stale.count; i++) {
+        objCtx.sourceFiles = (vl_file_paths){&stale.items[i], 1, 0};
+        objCtx.outputPath = VL__temp_ObjectName(stale.items[i]);
+        const char *object = VL_GetFilePathFromCompileCtx(&objCtx);
+
+        u64 key = VL__CompileCacheKey(&objCtx, temp_sprintf("%s.i", object));
+        DaAppend(&keys, key);
+        if(VL__CompileCacheGet(&objCtx, key, object)) continue;
+
+        VL_SetupCCompile(opt.cmd, &objCtx);
+        if(!CmdRun(opt.cmd, .async = &procs, .maxProcs = maxProcs, .captureOutput = true)) VL_ReturnDefer(false);
+    }
+
+    if(!VL_ProcsFlush(&procs)) VL_ReturnDefer(false);
+
+    if(stale.count > 0) {
+        for(size_t i = 0; i < stale.count; i++) {
+            objCtx.sourceFiles = (vl_file_paths){&stale.items[i], 1, 0};
+            objCtx.outputPath = VL__temp_ObjectName(stale.items[i]);
+            const char *cached = VL__temp_CompileCachePath(&objCtx, keys.items[i]);
+            if(!VL_FileExists(cached)) VL__CompileCachePut(&objCtx, keys.items[i], VL_GetFilePathFromCompileCtx(&objCtx));
+        }
+        VL__CompileCacheTrim();
+    }
+
+    if(ctx->precompiledHeader && (ctx->cc == CCompiler_MSVC)) {
+        DaAppend(&objects, VL__temp_PchObject(ctx));
+    }
+
+    vl_compile_ctx linkCtx = *ctx;
+    linkCtx.parallel = false;
+    linkCtx.precompiledHeader = 0;
+    linkCtx.sourceFiles = objects;
+    linkCtx.includePaths = (vl_file_paths){0};
+
+    const char *output;
+    if(ctx->type == Compile_StaticLibrary) {
+        if(ctx->cc == CCompiler_MSVC) {
+            output = temp_sprintf("%s/%s.lib", ctx->outputDir, ctx->outputPath);
+        } else {
+            output = temp_sprintf("%s/lib%s.a", ctx->outputDir, ctx->outputPath);
+        }
+    } else {
+        output = VL_GetFilePathFromCompileCtx(&linkCtx);
+    }
+
+    u64 linkHash = VL__HashCompileFlags(&linkCtx);
+    int needsLink = VL__NeedsLink(output, linkHash, objects);
+    if(needsLink < 0) VL_ReturnDefer(false);
+    if(needsLink == 0) {
+        VL_Log(VL_ECHO, "%s is up to date", output);
+        VL_ReturnDefer(true);
+    }
+
+    if(ctx->type == Compile_StaticLibrary) {
+        if(ctx->cc == CCompiler_MSVC) {
+            CmdAppend(opt.cmd, "lib", "-nologo", temp_sprintf("/OUT:%s", output));
         } else {
-            CmdAppend(opt.cmd, "-Wl,--gc-sections");
+            // NOTE: ar would keep the objects that are not in the list anymore
+            if(VL_FileExists(output) && !VL_DeleteFile(output)) VL_ReturnDefer(false);
+            CmdAppend(opt.cmd, "ar", "rcs", output);
+        }
+        DaAppendMany(opt.cmd, objects.items, objects.count);
+    } else {
+        VL_SetupCCompile(opt.cmd, &linkCtx);
+    }
+
+    VL__DepsSet(VL__DepsCreate(ViewFromCstr(output), linkHash, 0, 0, 0));
+    VL__DepsSave();
+
+    if(!CmdRun_Opt(opt)) {
+        VL__DepsRemove(ViewFromCstr(output));
+        VL__DepsSave();
+        VL_ReturnDefer(false);
+    }
+
+defer:
+    VL_needsRebuildContext.batchSaves = batchingSaves;
+    VL__DepsSave();
+    VL__HashesSave();
+    opt.cmd->count = 0;
+    DaFree(procs);
+    DaFree(objects);
+    DaFree(stale);
+    DaFree(flags);
+    DaFree(keys);
+    temp_rewind(tempMark);
+    return result;
+}
+
+static bool VL__CCompileCached(vl_compile_ctx *ctx, vl_cmd_opts opt)
+{
+    size_t tempMark = temp_save();
+    vl_file_paths flags = {0};
+    const char *output = VL_GetFilePathFromCompileCtx(ctx);
+    const char *preprocessed = temp_sprintf("%s.i", output);
+
+    VL__SetupPreprocess(opt.cmd, ctx, preprocessed, &flags);
+    bool ok = CmdRun_Opt(opt);
+    DaFree(flags);
+
+    u64 key = ok ? VL__CompileCacheKey(ctx, preprocessed) : 0;
+    if(!VL__CompileCacheGet(ctx, key, output)) {
+        VL_SetupCCompile(opt.cmd, ctx);
+        ok = CmdRun_Opt(opt);
+        if(ok) {
+            VL__CompileCachePut(ctx, key, output);
+            VL__CompileCacheTrim();
+        }
+    }
+
+    temp_rewind(tempMark);
+    return ok;
+}
+
+// Each unity_N.c #includes unityBatchSize of the source files, so the compiler gets started and
+// the headers get parsed once per batch instead of once per file. The batches are compiled as
+// the sources of ctx, so with .parallel every batch is an object compiled in parallel
+static bool VL__CCompileUnity(vl_compile_ctx *ctx, vl_cmd_opts opt)
+{
+    bool result = true;
+    size_t tempMark = temp_save();
+    vl_file_paths batches = {0};
+    string_builder sb = {0};
+
+    if(!ctx->outputDir) {
+        ctx->outputDir = ".";
+    }
+    const char *unityDir = temp_sprintf("%s/unity", ctx->outputDir);
+    if(!VL_FileExists(unityDir) && !MkdirIfNotExist(unityDir)) VL_ReturnDefer(false);
+
+    for(size_t first = 0; first < ctx->sourceFiles.count; first += ctx->unityBatchSize) {
+        size_t last = min(first + ctx->unityBatchSize, ctx->sourceFiles.count);
+        sb.count = 0;
+        for(size_t i = first; i < last; i++) {
+            // NOTE: absolute, the #includes are relative to the unity file otherwise
+            const char *source = VL__temp_AbsolutePath(ctx->sourceFiles.items[i]);
+            if(!source) VL_ReturnDefer(false);
+            SbAppendf(&sb, "#include \"%s\"\n", source);
+        }
+        SbAppendNull(&sb);
+
+        const char *batch = temp_sprintf("%s/unity_%zu.c", unityDir, batches.count);
+        if(!VL__WriteFileIfChanged(batch, sb.items)) {
+            VL_Log(VL_ERROR, "Could not write '%s'", batch);
+            VL_ReturnDefer(false);
         }
+        DaAppend(&batches, batch);
+    }
+
+    vl_compile_ctx unityCtx = *ctx;
+    unityCtx.unityBatchSize = 0;
+    unityCtx.sourceFiles = batches;
+    result = VL_CCompile_Opt(&unityCtx, opt);
+
+defer:
+    DaFree(batches);
+    SbFree(sb);
+    temp_rewind(tempMark);
+    return result;
+}
+
+VLIBPROC bool VL_CCompile_Opt(vl_compile_ctx *ctx, vl_cmd_opts opt)
+{
+    if((ctx->unityBatchSize > 0) && (ctx->type != Compile_PrecompiledHeader)) {
+        return VL__CCompileUnity(ctx, opt);
+    }
+    if(ctx->parallel && (ctx->type != Compile_Object)) {
+        return VL__CCompileParallel(ctx, opt);
+    }
+
+    if((ctx->type != Compile_PrecompiledHeader) && !VL_PrecompileHeader(ctx)) {
+        opt.cmd->count = 0;
+        return false;
+    }
+
+    if(VL_CompileCache && (ctx->type == Compile_Object) && (ctx->sourceFiles.count == 1) &&
+       ctx->outputPath && !opt.async)
+    {
+        return VL__CCompileCached(ctx, opt);
     }
 
+    VL_SetupCCompile(opt.cmd, ctx);
+    const char *output = VL_GetFilePathFromCompileCtx(ctx);
+
     bool ok = CmdRun_Opt(opt);
 
     if(ok && ctx->type == Compile_StaticLibrary) {
         if(ctx->cc == CCompiler_MSVC) {
             CmdAppend(opt.cmd, "lib", "-nologo", output);
+            if(ctx->precompiledHeader) CmdAppend(opt.cmd, VL__temp_PchObject(ctx));
         } else {
             CmdAppend(opt.cmd, "ar", "rcs",
-                temp_sprintf("%s/lib%s.a", ctx->outputDir, ctx->output), output);
+                temp_sprintf("%s/lib%s.a", ctx->outputDir, ctx->outputPath), output);
         }
 
         if(opt.async) {
@@ -2182,6 +4993,11 @@ static void Win32_CmdQuote(vl_cmd cmd, string_builder *quoted)
 #endif
 
 VLIBPROC vl_proc VL_CmdStartProcess(vl_cmd cmd, vl_fd *fdin, vl_fd *fdout, vl_fd *fderr, bool render)
+{
+    return VL_CmdStartProcessIn(cmd, fdin, fdout, fderr, render, 0);
+}
+
+VLIBPROC vl_proc VL_CmdStartProcessIn(vl_cmd cmd, vl_fd *fdin, vl_fd *fdout, vl_fd *fderr, bool render, const char *workingDir)
 {
     if(cmd.count < 1) {
         VL_Log(VL_ERROR, "Could not run empty command");
@@ -2195,7 +5011,8 @@ VLIBPROC vl_proc VL_CmdStartProcess(vl_cmd cmd, vl_fd *fdin, vl_fd *fdout, vl_fd
     if(render) {
         VL_CmdRender(cmd, &sb);
         SbAppendNull(&sb);
-        VL_Log(VL_INFO, "CMD: %s", sb.items);
+        if(workingDir) VL_Log(VL_INFO, "CMD: %s (in %s)", sb.items, workingDir);
+        else VL_Log(VL_INFO, "CMD: %s", sb.items);
         SbFree(sb);
         memset(&sb, 0, sizeof(sb));
     }
@@ -2219,7 +5036,7 @@ VLIBPROC vl_proc VL_CmdStartProcess(vl_cmd cmd, vl_fd *fdin, vl_fd *fdout, vl_fd
 
     Win32_CmdQuote(cmd, &sb);
     SbAppendNull(&sb);
-    BOOL bSuccess = CreateProcessA(NULL, sb.items, NULL, NULL, TRUE, 0, NULL, NULL, &siStartInfo, &piProcInfo);
+    BOOL bSuccess = CreateProcessA(NULL, sb.items, NULL, NULL, TRUE, 0, NULL, workingDir, &siStartInfo, &piProcInfo);
     SbFree(sb);
 
     if(!bSuccess) {
@@ -2259,6 +5076,11 @@ VLIBPROC vl_proc VL_CmdStartProcess(vl_cmd cmd, vl_fd *fdin, vl_fd *fdout, vl_fd
             }
         }
 
+        if(workingDir && (chdir(workingDir) < 0)) {
+            VL_Log(VL_ERROR, "Could not change to directory %s for child process: %s", workingDir, strerror(errno));
+            exit(1);
+        }
+
         // NOTE: This leaks a bit of memory in the child process.
         // But do we actually care? It's a one off leak anyway...
         vl_cmd cmdNull = {0};